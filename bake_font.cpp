@@ -0,0 +1,206 @@
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_GLYPH_H
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "./include/baked_font.hpp"
+
+// Build step: rasterizes the printable ASCII glyphs of a font at the given
+// character sizes into one coverage atlas and writes it, with the glyph
+// metrics and kerning pairs, as a C++ source that defines the arrays declared
+// in baked_font.hpp. Glyphs are loaded, measured and padded the way sf::Font
+// does it, so baked text lays out like sf::Text.
+//   bake_font.x FONT OUTPUT SIZE...
+
+const unsigned ATLAS_PADDING = 2; // transparent pixels around each glyph, sf::Text samples one of them
+
+struct Bitmap
+{
+    unsigned width = 0;
+    unsigned height = 0;
+    std::vector<unsigned char> coverage;
+};
+
+// Row-major coverage of the rendered glyph in face->glyph, with the metrics sf::Font reports
+bool renderGlyph(FT_Face face, unsigned character, BakedGlyph &glyph, Bitmap &bitmap)
+{
+    if (FT_Load_Char(face, character, FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT) != 0)
+        return false;
+    FT_Glyph description;
+    if (FT_Get_Glyph(face->glyph, &description) != 0)
+        return false;
+    FT_Glyph_To_Bitmap(&description, FT_RENDER_MODE_NORMAL, nullptr, 1);
+    const FT_Bitmap &rendered = reinterpret_cast<FT_BitmapGlyph>(description)->bitmap;
+
+    const FT_Glyph_Metrics &metrics = face->glyph->metrics;
+    glyph.character = static_cast<std::uint8_t>(character);
+    glyph.advance = metrics.horiAdvance / 64.0f;
+    glyph.left = metrics.horiBearingX / 64.0f;
+    glyph.top = -metrics.horiBearingY / 64.0f;
+    glyph.width = metrics.width / 64.0f;
+    glyph.height = metrics.height / 64.0f;
+
+    bitmap.width = rendered.width;
+    bitmap.height = rendered.rows;
+    bitmap.coverage.assign(static_cast<size_t>(bitmap.width) * bitmap.height, 0);
+    for (unsigned y = 0; y < bitmap.height; ++y)
+    {
+        const unsigned char *row = rendered.buffer + static_cast<std::ptrdiff_t>(y) * rendered.pitch;
+        for (unsigned x = 0; x < bitmap.width; ++x)
+        {
+            // Monochrome bitmaps come from fonts with embedded bitmaps at small sizes
+            unsigned char value = rendered.pixel_mode == FT_PIXEL_MODE_MONO ? (((row[x / 8] >> (7 - x % 8)) & 1) ? 255 : 0) : row[x];
+            bitmap.coverage[static_cast<size_t>(y) * bitmap.width + x] = value;
+        }
+    }
+    FT_Done_Glyph(description);
+    return true;
+}
+
+void writeBytes(std::ostream &out, const unsigned char *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out << static_cast<unsigned>(data[i]) << (i % 32 == 31 ? ",\n" : ",");
+    out << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::cout << "Usage: " << argv[0] << " FONT OUTPUT SIZE...\n";
+        return 1;
+    }
+
+    std::ifstream fontFile(argv[1], std::ios::binary);
+    std::vector<unsigned char> fontData((std::istreambuf_iterator<char>(fontFile)), std::istreambuf_iterator<char>());
+    FT_Library library;
+    FT_Face face;
+    if (fontData.empty() || FT_Init_FreeType(&library) != 0 ||
+        FT_New_Memory_Face(library, fontData.data(), static_cast<FT_Long>(fontData.size()), 0, &face) != 0)
+    {
+        std::cout << "Could not load font " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::vector<BakedSize> sizes;
+    std::vector<BakedGlyph> glyphs;
+    std::vector<BakedKerning> kerning;
+    std::vector<Bitmap> bitmaps;
+    for (int arg = 3; arg < argc; ++arg)
+    {
+        unsigned characterSize = static_cast<unsigned>(std::atoi(argv[arg]));
+        if (characterSize == 0 || characterSize > 255 || FT_Set_Pixel_Sizes(face, 0, characterSize) != 0)
+        {
+            std::cout << "Cannot bake character size " << argv[arg] << "\n";
+            return 1;
+        }
+        sizes.push_back(BakedSize{static_cast<std::uint8_t>(characterSize), face->size->metrics.height / 64.0f});
+
+        for (unsigned character = ATLAS_FIRST_CHARACTER; character <= ATLAS_LAST_CHARACTER; ++character)
+        {
+            BakedGlyph glyph{};
+            Bitmap bitmap;
+            if (!renderGlyph(face, character, glyph, bitmap))
+                continue;
+            glyph.characterSize = static_cast<std::uint8_t>(characterSize);
+            glyphs.push_back(glyph);
+            bitmaps.push_back(bitmap);
+        }
+
+        // Same rounding as sf::Font::getKerning: 26.6 fixed point to pixels
+        if (FT_HAS_KERNING(face))
+        {
+            for (unsigned first = ATLAS_FIRST_CHARACTER; first <= ATLAS_LAST_CHARACTER; ++first)
+            {
+                for (unsigned second = ATLAS_FIRST_CHARACTER; second <= ATLAS_LAST_CHARACTER; ++second)
+                {
+                    FT_Vector offset;
+                    FT_Get_Kerning(face, FT_Get_Char_Index(face, first), FT_Get_Char_Index(face, second), FT_KERNING_DEFAULT, &offset);
+                    if (offset.x != 0)
+                        kerning.push_back(BakedKerning{static_cast<std::uint8_t>(characterSize), static_cast<std::uint8_t>(first),
+                                                       static_cast<std::uint8_t>(second), offset.x / 64.0f});
+                }
+            }
+        }
+    }
+
+    // Shelf packing in bake order, which keeps each size on neighbouring rows
+    unsigned shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (size_t g = 0; g < glyphs.size(); ++g)
+    {
+        if (bitmaps[g].width == 0 || bitmaps[g].height == 0)
+            continue;
+        unsigned width = bitmaps[g].width + 2 * ATLAS_PADDING;
+        unsigned height = bitmaps[g].height + 2 * ATLAS_PADDING;
+        if (shelfX + width > BAKED_ATLAS_WIDTH)
+        {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+        glyphs[g].x = static_cast<std::uint16_t>(shelfX + ATLAS_PADDING);
+        glyphs[g].y = static_cast<std::uint16_t>(shelfY + ATLAS_PADDING);
+        glyphs[g].pixelWidth = static_cast<std::uint16_t>(bitmaps[g].width);
+        glyphs[g].pixelHeight = static_cast<std::uint16_t>(bitmaps[g].height);
+        shelfX += width;
+        shelfHeight = std::max(shelfHeight, height);
+    }
+    const unsigned atlasHeight = shelfY + shelfHeight;
+    std::vector<unsigned char> atlas(static_cast<size_t>(BAKED_ATLAS_WIDTH) * atlasHeight, 0);
+    for (size_t g = 0; g < glyphs.size(); ++g)
+    {
+        for (unsigned y = 0; y < bitmaps[g].height; ++y)
+        {
+            for (unsigned x = 0; x < bitmaps[g].width; ++x)
+                atlas[static_cast<size_t>(glyphs[g].y + y) * BAKED_ATLAS_WIDTH + glyphs[g].x + x] = bitmaps[g].coverage[static_cast<size_t>(y) * bitmaps[g].width + x];
+        }
+    }
+
+    // Metrics are multiples of 1/64, which nine digits print exactly; showpoint keeps "8.0f" a float literal
+    std::ofstream out(argv[2]);
+    out << std::setprecision(9) << std::showpoint;
+    out << "// Generated by bake_font.x from " << argv[1] << ", do not edit\n"
+        << "#include \"baked_font.hpp\"\n\n";
+    out << "const unsigned BAKED_ATLAS_HEIGHT = " << atlasHeight << ";\n";
+    out << "const unsigned char BAKED_ATLAS[] = {\n";
+    writeBytes(out, atlas.data(), atlas.size());
+    out << "};\n\n";
+
+    out << "const BakedSize BAKED_SIZES[] = {\n";
+    for (const BakedSize &size : sizes)
+        out << "    {" << unsigned(size.characterSize) << ", " << size.lineSpacing << "f},\n";
+    out << "};\nconst size_t BAKED_SIZE_COUNT = " << sizes.size() << ";\n\n";
+
+    out << "const BakedGlyph BAKED_GLYPHS[] = {\n";
+    for (const BakedGlyph &glyph : glyphs)
+        out << "    {" << unsigned(glyph.characterSize) << ", " << unsigned(glyph.character) << ", " << glyph.advance << "f, "
+            << glyph.left << "f, " << glyph.top << "f, " << glyph.width << "f, " << glyph.height << "f, " << glyph.x << ", "
+            << glyph.y << ", " << glyph.pixelWidth << ", " << glyph.pixelHeight << "},\n";
+    out << "};\nconst size_t BAKED_GLYPH_COUNT = " << glyphs.size() << ";\n\n";
+
+    // A dummy entry keeps the array valid for fonts without kerning
+    out << "const BakedKerning BAKED_KERNING[] = {\n";
+    for (const BakedKerning &pair : kerning)
+        out << "    {" << unsigned(pair.characterSize) << ", " << unsigned(pair.first) << ", " << unsigned(pair.second) << ", "
+            << pair.offset << "f},\n";
+    out << "    {0, 0, 0, 0.0f},\n};\nconst size_t BAKED_KERNING_COUNT = " << kerning.size() << ";\n";
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    if (!out)
+    {
+        std::cout << "Could not write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cout << "Baked " << glyphs.size() << " glyphs at " << sizes.size() << " sizes into a " << BAKED_ATLAS_WIDTH << "x"
+              << atlasHeight << " atlas\n";
+    return 0;
+}
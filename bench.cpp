@@ -0,0 +1,284 @@
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include "./include/ssr.hpp"
+#include "./include/simulation.hpp"
+#include "./include/allocation_counter.hpp"
+#include "./include/jump_kernel.hpp"
+#include "./include/density_renderer.hpp"
+
+// Microbenchmarks for the SSR hot paths, written as JSON so results from two
+// builds can be diffed:
+//   turbo      discrete SSR steps per second and allocations per step
+//   jumps      the jump interpolation kernel alone, for each kernel the CPU supports
+//   frame      one 60 FPS frame of the animation (two fixed steps and a snapshot)
+//   histogram  updateHistogram after a frame's worth of visits
+//   density    the heatmap's scatter, merge and coloring for one frame, without the upload
+// Allocations are counted by the operator new in src/allocation_counter.cpp.
+
+using BenchClock = std::chrono::steady_clock;
+
+double secondsSince(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Fills the store with count balls spread over the boxes, half of them mid-jump,
+// so a frame touches every branch of the per-ball update
+void seedPopulation(Simulation &sim, size_t count, std::mt19937 &rng)
+{
+    const int boxCount = sim.layout.boxCount;
+    std::uniform_int_distribution<int> boxDist(0, boxCount - 2);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    sim.balls.clear();
+    for (size_t b = 0; b < count; ++b)
+    {
+        int box = boxDist(rng);
+        double restStart = sim.simTime - unit(rng) * sim.waitTime;
+        size_t i = sim.balls.spawn(sim.layout.restPosition(box), box, restStart, sf::Color::Green, static_cast<std::uint32_t>(b));
+        if (b % 2 == 1)
+        {
+            int target = std::uniform_int_distribution<int>(box + 1, boxCount - 1)(rng);
+            sim.balls.setJump(i, sim.balls.position[i], target, sim.layout.restPosition(target));
+            sim.balls.isJumping[i] = 1;
+            sim.balls.jumpProgress[i] = unit(rng);
+        }
+    }
+    sim.nextBallId = static_cast<std::uint32_t>(count);
+}
+
+std::string benchTurbo(int boxCount, float multiplicativeFactor, double seconds)
+{
+    Simulation sim;
+    initSimulation(sim, boxCount, multiplicativeFactor, 42);
+    sim.turbo = true;
+
+    // Warm up so the stores reach their peak size before measuring
+    for (int i = 0; i < 10; ++i)
+        stepTurbo(sim, FIXED_TIMESTEP);
+
+    std::uint64_t startSteps = sim.stepCount;
+    std::uint64_t startAllocations = allocationCount.load();
+    auto start = BenchClock::now();
+    int ticks = 0;
+    while (secondsSince(start) < seconds)
+    {
+        stepTurbo(sim, FIXED_TIMESTEP);
+        ticks++;
+    }
+    double elapsed = secondsSince(start);
+    std::uint64_t steps = sim.stepCount - startSteps;
+    std::uint64_t allocations = allocationCount.load() - startAllocations;
+
+    std::ostringstream out;
+    out << "{\"name\": \"turbo\", \"states\": " << boxCount - 1 << ", \"factor\": " << multiplicativeFactor
+        << ", \"ticks\": " << ticks << ", \"steps\": " << steps
+        << ", \"steps_per_second\": " << (elapsed > 0 ? steps / elapsed : 0.0)
+        << ", \"allocations_per_step\": " << (steps > 0 ? static_cast<double>(allocations) / steps : 0.0) << "}";
+    return out.str();
+}
+
+std::string benchJumps(JumpKernel kernel, size_t ballCount, int passes)
+{
+    Simulation sim;
+    initSimulation(sim, DEFAULT_BOX_COUNT, 1.0f, 42);
+    std::mt19937 rng(7);
+    seedPopulation(sim, ballCount, rng);
+    BallStore &balls = sim.balls;
+    std::vector<std::uint8_t> landed(ballCount);
+
+    JumpBatch batch;
+    batch.count = ballCount;
+    batch.isJumping = balls.isJumping.data();
+    batch.progress = balls.jumpProgress.data();
+    batch.startX = balls.startX.data();
+    batch.startY = balls.startY.data();
+    batch.targetX = balls.targetX.data();
+    batch.targetY = balls.targetY.data();
+    batch.position = reinterpret_cast<float *>(balls.position.data());
+    batch.landed = landed.data();
+
+    // A tiny step keeps the jumps in flight for every pass
+    auto start = BenchClock::now();
+    for (int pass = 0; pass < passes; ++pass)
+        advanceJumps(batch, 1e-7f, kernel);
+    double elapsed = secondsSince(start);
+
+    std::ostringstream out;
+    out << "{\"name\": \"jumps\", \"kernel\": \"" << jumpKernelName(kernel) << "\", \"balls\": " << ballCount
+        << ", \"passes\": " << passes
+        << ", \"balls_per_second\": " << (elapsed > 0 ? ballCount * static_cast<double>(passes) / elapsed : 0.0) << "}";
+    return out.str();
+}
+
+std::string benchFrame(size_t ballCount, float multiplicativeFactor, int frames)
+{
+    Simulation sim;
+    initSimulation(sim, DEFAULT_BOX_COUNT, multiplicativeFactor, 42);
+    sim.maxAnimatedBalls = ballCount * 4 + 1000; // measure the animation, not the cascade hand-off
+    std::mt19937 rng(7);
+
+    // Each repetition restarts from the same population so the ball count stays near the target
+    const int framesPerRepetition = 60;
+    double updateSeconds = 0.0;
+    double snapshotSeconds = 0.0;
+    std::uint64_t allocations = 0;
+    std::uint64_t steps = 0;
+    int measured = 0;
+    while (measured < frames)
+    {
+        seedPopulation(sim, ballCount, rng);
+        publishSnapshot(sim);
+        for (int f = 0; f < framesPerRepetition && measured < frames; ++f, ++measured)
+        {
+            std::uint64_t startSteps = sim.stepCount;
+            std::uint64_t startAllocations = allocationCount.load();
+            auto start = BenchClock::now();
+            stepSimulation(sim, FIXED_TIMESTEP);
+            stepSimulation(sim, FIXED_TIMESTEP);
+            auto updated = BenchClock::now();
+            publishSnapshot(sim);
+            snapshotSeconds += secondsSince(updated);
+            updateSeconds += std::chrono::duration<double>(updated - start).count();
+            allocations += allocationCount.load() - startAllocations;
+            steps += sim.stepCount - startSteps;
+        }
+    }
+
+    std::ostringstream out;
+    out << "{\"name\": \"frame\", \"balls\": " << ballCount << ", \"factor\": " << multiplicativeFactor
+        << ", \"frames\": " << frames
+        << ", \"update_ms\": " << updateSeconds * 1000.0 / frames
+        << ", \"snapshot_ms\": " << snapshotSeconds * 1000.0 / frames
+        << ", \"steps_per_frame\": " << static_cast<double>(steps) / frames
+        << ", \"allocations_per_frame\": " << static_cast<double>(allocations) / frames << "}";
+    return out.str();
+}
+
+std::string benchHistogram(int boxCount, int frames)
+{
+    HistogramModel model;
+    createHistogramModel(model, boxCount);
+    GlyphAtlas atlas; // glyph tables without the texture, so labels are laid out as in the window
+    initGlyphAtlas(atlas);
+    Hud hud;
+    createHud(hud, atlas);
+    std::vector<HistogramBar> histogram;
+    sf::VertexArray bars;
+    createHistogram(histogram, bars, model, hud);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> binDist(0, model.binCount() - 1);
+    std::vector<std::uint64_t> binVisits(model.binCount(), 0);
+
+    double seconds = 0.0;
+    std::uint64_t allocations = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        for (int v = 0; v < 64; ++v)
+            binVisits[binDist(rng)] += 1 + f;
+        std::uint64_t startAllocations = allocationCount.load();
+        auto start = BenchClock::now();
+        syncHistogramModel(model, binVisits);
+        updateHistogram(histogram, bars, model, hud);
+        updateHud(hud);
+        seconds += secondsSince(start);
+        allocations += allocationCount.load() - startAllocations;
+    }
+
+    std::ostringstream out;
+    out << "{\"name\": \"histogram\", \"states\": " << boxCount - 1 << ", \"bins\": " << model.binCount()
+        << ", \"frames\": " << frames << ", \"update_ms\": " << seconds * 1000.0 / frames
+        << ", \"allocations_per_frame\": " << static_cast<double>(allocations) / frames << "}";
+    return out.str();
+}
+
+std::string benchDensity(size_t ballCount, int frames)
+{
+    Simulation sim;
+    initSimulation(sim, DEFAULT_BOX_COUNT, 1.0f, 42);
+    std::mt19937 rng(7);
+    seedPopulation(sim, ballCount, rng);
+    RenderSnapshot snapshot;
+    snapshot.position = sim.balls.position;
+
+    DensityRenderer renderer;
+    initDensityGrid(renderer, 0);
+    accumulateDensity(renderer, snapshot, 1.0f / 60.0f); // warm-up frame
+
+    std::uint64_t startAllocations = allocationCount.load();
+    auto start = BenchClock::now();
+    for (int f = 0; f < frames; ++f)
+        accumulateDensity(renderer, snapshot, 1.0f / 60.0f);
+    double elapsed = secondsSince(start);
+    std::uint64_t allocations = allocationCount.load() - startAllocations;
+
+    std::ostringstream out;
+    out << "{\"name\": \"density\", \"balls\": " << ballCount << ", \"threads\": " << renderer.threads
+        << ", \"frames\": " << frames << ", \"frame_ms\": " << elapsed * 1000.0 / frames
+        << ", \"allocations_per_frame\": " << static_cast<double>(allocations) / frames << "}";
+    return out.str();
+}
+
+int main(int argc, char **argv)
+{
+    std::string outputPath;
+    double turboSeconds = 1.0;
+    int frames = 240;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--output")
+            outputPath = argv[++i];
+        else if (arg == "--seconds")
+            turboSeconds = std::atof(argv[++i]);
+        else if (arg == "--frames")
+            frames = std::max(1, std::atoi(argv[++i]));
+    }
+
+    const float factors[] = {1.0f, 1.5f, 2.0f, 2.5f};
+    const size_t ballCounts[] = {1, 100, 1000, 100000};
+    const int histogramBoxCounts[] = {DEFAULT_BOX_COUNT, 301, MAX_BOX_COUNT};
+
+    std::vector<std::string> results;
+    for (float factor : factors)
+        results.push_back(benchTurbo(DEFAULT_BOX_COUNT, factor, turboSeconds));
+    JumpKernel best = selectJumpKernel();
+    for (JumpKernel kernel : {JumpKernel::Scalar, JumpKernel::Sse41, JumpKernel::Avx2})
+    {
+        if (static_cast<int>(kernel) <= static_cast<int>(best))
+            results.push_back(benchJumps(kernel, 100000, frames * 10));
+    }
+    for (size_t balls : ballCounts)
+    {
+        for (float factor : {1.0f, 2.0f})
+            results.push_back(benchFrame(balls, factor, frames));
+    }
+    for (int boxCount : histogramBoxCounts)
+        results.push_back(benchHistogram(boxCount, frames));
+    for (size_t balls : {size_t(1000), size_t(100000), size_t(1000000)})
+        results.push_back(benchDensity(balls, frames));
+
+    std::ostringstream json;
+    json << "{\n  \"benchmarks\": [\n";
+    for (size_t r = 0; r < results.size(); ++r)
+        json << "    " << results[r] << (r + 1 < results.size() ? ",\n" : "\n");
+    json << "  ]\n}\n";
+
+    if (outputPath.empty())
+        std::cout << json.str();
+    else
+    {
+        std::ofstream file(outputPath);
+        file << json.str();
+        std::cout << "Results written to " << outputPath << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include "./include/ssr_engine.hpp"
+#include "./include/event_log.hpp"
+#include "./include/sweep.hpp"
+#include "./include/cycle_stats.hpp"
+#include "./include/exact_distribution.hpp"
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [--mode particle|cascade] [--states N] [--factor MU] [--cycles C] [--threads T] [--seed S]\n"
+              << "       " << program << "     [--prior-power A | --prior FILE] [--noise LAMBDA]\n"
+              << "       " << program << " --sweep-factors MU,MU,... [--sweep-states N,N,...] [--batches B] [--bootstrap R] [--output FILE]\n"
+              << "       " << program << " --validate [--states N] [--cycles C] [--threads T] [--seed S]\n"
+              << "       " << program << " --replay FILE\n"
+              << "       " << program << " --read-stats FILE\n";
+}
+
+const char *modeName(EngineMode mode)
+{
+    switch (mode)
+    {
+    case EngineMode::Cascade:
+        return "cascade";
+    default:
+        return "particle";
+    }
+}
+
+// Runs every factor and state count of the grid and writes one row per pair
+int runSweepTable(SweepConfig &sweep, const std::string &outputPath)
+{
+    if (sweep.factors.empty())
+        sweep.factors.push_back(sweep.base.multiplicativeFactor);
+    if (sweep.stateCounts.empty())
+        sweep.stateCounts.push_back(sweep.base.boxCount - 1);
+    for (float factor : sweep.factors)
+    {
+        if (factor < 0.0f)
+            return -1;
+    }
+    for (int states : sweep.stateCounts)
+    {
+        if (states < 1)
+            return -1;
+        SsrProcess process;
+        if (!makeSweepProcess(process, sweep, states))
+        {
+            std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+            return -1;
+        }
+        for (float factor : sweep.factors)
+        {
+            if (!cycleTerminates(process, factor))
+            {
+                std::cout << "With noise " << sweep.base.noise << ", factor " << factor << " and " << states
+                          << " states cycles never end\n";
+                return -1;
+            }
+        }
+    }
+
+    std::vector<SweepRow> rows = runSweep(sweep);
+    if (outputPath.empty())
+    {
+        writeSweepTable(sweep, rows, std::cout);
+        return 0;
+    }
+    std::ofstream file(outputPath);
+    if (!file)
+    {
+        std::cout << "Could not write " << outputPath << "\n";
+        return -1;
+    }
+    writeSweepTable(sweep, rows, file);
+    return 0;
+}
+
+// Runs the cascade against the step simulator and reports throughput of both.
+// With factor 1 each state is visited at most once per cycle, which the z-score assumes.
+int validateCascade(EngineConfig config)
+{
+    config.multiplicativeFactor = 1.0f;
+
+    EngineResult steps;
+    EngineResult counts;
+    config.mode = EngineMode::Particle;
+    bool ran = runEngine(config, steps);
+    config.mode = EngineMode::Cascade;
+    config.seed += 1;
+    ran = ran && runEngine(config, counts);
+    if (!ran)
+    {
+        std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+        return 1;
+    }
+
+    // The max of boxCount normal z-scores grows like sqrt(2 ln boxCount); allow two sigma on top
+    double maxZ = maxVisitZScore(steps, counts);
+    double threshold = std::sqrt(2.0 * std::log(2.0 * config.boxCount)) + 2.0;
+    std::cout << "# states " << config.boxCount - 1 << " cycles " << config.cycles << "\n";
+    std::cout << "particle cycles_per_second " << steps.cycles / steps.seconds << "\n";
+    std::cout << "cascade cycles_per_second " << counts.cycles / counts.seconds << "\n";
+    std::cout << "max_z_score " << maxZ << " threshold " << threshold << "\n";
+
+    if (maxZ > threshold)
+    {
+        std::cout << "FAILED: cascade disagrees with the step simulator\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
+
+// Checks that cycleTerminates refuses exactly the noisy runs whose exact
+// distribution diverges, over a grid of states, noise levels and factors
+int validateTermination()
+{
+    const int stateCounts[] = {2, 20, 100, 1000};
+    const double noises[] = {0.01, 0.05, 0.2, 0.5};
+    const float factors[] = {1.0f, 1.2f, 1.5f, 2.0f, 3.0f};
+    const double priorPowers[] = {0.0, -1.0, 1.0};
+    int checked = 0, disagreements = 0;
+    for (int states : stateCounts)
+    {
+        for (double priorPower : priorPowers)
+        {
+            std::vector<double> prior = priorPower != 0.0 ? powerPrior(states, priorPower) : std::vector<double>();
+            for (double noise : noises)
+            {
+                SsrProcess process;
+                makeProcess(process, states + 1, prior, noise);
+                for (float factor : factors)
+                {
+                    std::vector<double> expected;
+                    bool finite = exactVisits(process, factor, expected);
+                    checked++;
+                    if (finite != cycleTerminates(process, factor))
+                    {
+                        disagreements++;
+                        std::cout << "termination disagrees: states " << states << " prior_power " << priorPower
+                                  << " noise " << noise << " factor " << factor << "\n";
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "termination_checks " << checked << " disagreements " << disagreements << "\n";
+    return disagreements > 0 ? 1 : 0;
+}
+
+// Prints the visit distribution of a run recorded with --record-events
+int replayStatistics(const std::string &path)
+{
+    EventLogReader log;
+    if (!openEventLogReader(log, path))
+    {
+        std::cout << "Could not read event log " << path << "\n";
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    EngineResult result = replayEventLogStatistics(log);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const int boxCount = static_cast<int>(log.header->boxCount);
+    std::cout << "# replay " << path << " states " << boxCount - 1 << " seed " << log.header->seed
+              << " events " << log.count << " cycles " << result.cycles << "\n";
+    std::cout << "# state visits visits_per_cycle\n";
+    for (int state = 1; state < boxCount; ++state)
+    {
+        int box = boxCount - state;
+        double perCycle = result.cycles > 0 ? static_cast<double>(result.visits[box]) / result.cycles : 0.0;
+        std::cout << state << " " << result.visits[box] << " " << std::setprecision(8) << perCycle << "\n";
+    }
+    std::cout << "# steps " << result.steps << " seconds " << result.seconds << "\n";
+
+    closeEventLogReader(log);
+    return 0;
+}
+
+// Prints the visit distribution and cycle sizes of a run recorded with --record-stats
+int readCycleStats(const std::string &path)
+{
+    CycleStatsReader stats;
+    if (!openCycleStatsReader(stats, path))
+    {
+        std::cout << "Could not read statistics " << path << "\n";
+        return -1;
+    }
+
+    std::uint64_t records = 0, longestCycle = 0, peakBalls = 0, cascadeBalls = 0;
+    size_t offset = 0;
+    const CycleStatsRecord *record;
+    const CycleVisit *visits;
+    while (nextCycleStats(stats, offset, record, visits))
+    {
+        records++;
+        longestCycle = std::max(longestCycle, record->steps);
+        peakBalls = std::max(peakBalls, record->peakBalls);
+        cascadeBalls += record->cascadeBalls;
+    }
+    EngineResult result = summarizeCycleStats(stats);
+
+    const int boxCount = static_cast<int>(stats.header->boxCount);
+    std::cout << "# stats " << path << " states " << boxCount - 1 << " seed " << stats.header->seed
+              << " records " << records << " cycles " << result.cycles << "\n";
+    std::cout << "# longest_cycle " << longestCycle << " peak_balls " << peakBalls
+              << " cascade_balls " << cascadeBalls << "\n";
+    std::cout << "# state visits visits_per_cycle\n";
+    for (int state = 1; state < boxCount; ++state)
+    {
+        int box = boxCount - state;
+        double perCycle = result.cycles > 0 ? static_cast<double>(result.visits[box]) / result.cycles : 0.0;
+        std::cout << state << " " << result.visits[box] << " " << std::setprecision(8) << perCycle << "\n";
+    }
+    std::cout << "# steps " << result.steps << "\n";
+
+    closeCycleStatsReader(stats);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    EngineConfig config;
+    bool validate = false;
+    double priorPower = 0.0;
+    std::string priorPath, outputPath;
+    SweepConfig sweep;
+    bool modeSet = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--validate")
+        {
+            validate = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (arg == "--mode")
+        {
+            std::string mode = value;
+            modeSet = true;
+            if (mode == "cascade")
+                config.mode = EngineMode::Cascade;
+            else if (mode == "particle")
+                config.mode = EngineMode::Particle;
+            else
+            {
+                printUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if (arg == "--states")
+            config.boxCount = std::atoi(value) + 1;
+        else if (arg == "--factor")
+            config.multiplicativeFactor = std::strtof(value, nullptr);
+        else if (arg == "--cycles")
+            config.cycles = std::strtoull(value, nullptr, 10);
+        else if (arg == "--threads")
+            config.threads = static_cast<unsigned>(std::atoi(value));
+        else if (arg == "--seed")
+            config.seed = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--prior-power")
+            priorPower = std::strtod(value, nullptr);
+        else if (arg == "--prior")
+            priorPath = value;
+        else if (arg == "--noise")
+            config.noise = std::strtod(value, nullptr);
+        else if (arg == "--sweep-factors")
+        {
+            for (double factor : parseList(value))
+                sweep.factors.push_back(static_cast<float>(factor));
+        }
+        else if (arg == "--sweep-states")
+        {
+            for (double states : parseList(value))
+                sweep.stateCounts.push_back(static_cast<int>(states));
+        }
+        else if (arg == "--batches")
+            sweep.batches = std::atoi(value);
+        else if (arg == "--bootstrap")
+            sweep.bootstrap = std::atoi(value);
+        else if (arg == "--output")
+            outputPath = value;
+        else if (arg == "--replay")
+            return replayStatistics(value);
+        else if (arg == "--read-stats")
+            return readCycleStats(value);
+        else
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (config.boxCount < 2 || config.multiplicativeFactor < 0.0f || config.noise < 0.0 || config.noise > 1.0)
+    {
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    if (!priorPath.empty() && !loadPriorWeights(priorPath, config.prior))
+    {
+        std::cout << "Could not read prior weights from " << priorPath << "\n";
+        return -1;
+    }
+
+    if (!sweep.factors.empty() || !sweep.stateCounts.empty())
+    {
+        // Counts keep large factors affordable, so the sweep defaults to the cascade
+        if (!modeSet)
+            config.mode = EngineMode::Cascade;
+        sweep.base = config;
+        if (priorPath.empty())
+            sweep.priorPower = priorPower;
+        if (runSweepTable(sweep, outputPath) != 0)
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
+        return 0;
+    }
+    if (priorPath.empty() && priorPower != 0.0)
+        config.prior = powerPrior(config.boxCount - 1, priorPower);
+
+    SsrProcess process;
+    if (!makeProcess(process, config.boxCount, config.prior, config.noise))
+    {
+        std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+        return -1;
+    }
+
+    if (validate && (!process.uniform || process.noise > 0.0))
+    {
+        std::cout << "--validate compares standard SSR runs, without a prior or noise\n";
+        return -1;
+    }
+    if (!cycleTerminates(process, config.multiplicativeFactor))
+    {
+        std::cout << "With noise " << config.noise << " and factor " << config.multiplicativeFactor
+                  << " cycles never end: each noise jump leads to " << noiseRestartMean(process, config.multiplicativeFactor)
+                  << " more on average\n";
+        return -1;
+    }
+
+    if (validate)
+    {
+        int status = validateCascade(config);
+        return validateTermination() != 0 ? 1 : status;
+    }
+
+    EngineResult result;
+    if (!runEngine(config, result))
+    {
+        std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+        return -1;
+    }
+
+    // Same ordering as the histogram: state 1 is the last box
+    std::cout << "# mode " << modeName(config.mode)
+              << " states " << config.boxCount - 1 << " factor " << config.multiplicativeFactor
+              << " cycles " << result.cycles << " threads " << resolveThreadCount(config.threads)
+              << " process " << describeProcess(process) << "\n";
+    std::cout << "# state visits visits_per_cycle\n";
+    for (int state = 1; state < config.boxCount; ++state)
+    {
+        int box = config.boxCount - state;
+        double perCycle = result.cycles > 0 ? static_cast<double>(result.visits[box]) / result.cycles : 0.0;
+        std::cout << state << " " << result.visits[box] << " " << std::setprecision(8) << perCycle << "\n";
+    }
+
+    // Distance of the per-state counts from the exact law, one bin per box
+    std::vector<int> binOfBox(config.boxCount);
+    for (int box = 0; box < config.boxCount; ++box)
+        binOfBox[box] = box - 1;
+    ConvergenceTracker convergence;
+    if (resetConvergence(convergence, process, config.multiplicativeFactor, binOfBox, config.boxCount - 1, result.visits))
+    {
+        std::vector<std::uint64_t> boxVisits(result.visits.begin() + 1, result.visits.end());
+        std::cout << "# exact kl " << klDivergence(convergence) << " l1 " << l1Distance(convergence, boxVisits) << "\n";
+    }
+    std::cout << "# steps " << result.steps << " seconds " << result.seconds
+              << " steps_per_second " << (result.seconds > 0 ? result.steps / result.seconds : 0.0)
+              << " cycles_per_second " << (result.seconds > 0 ? result.cycles / result.seconds : 0.0) << "\n";
+
+    return 0;
+}
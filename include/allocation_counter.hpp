@@ -0,0 +1,8 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Number of global operator new calls so far. Defined with the counting
+// operator new in src/allocation_counter.cpp, which executables that read it
+// list among their sources.
+extern std::atomic<std::uint64_t> allocationCount;
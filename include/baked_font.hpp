@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the glyph atlas bake_font.x writes at build time. Kept free of
+// SFML so the bake tool only needs FreeType.
+
+const unsigned BAKED_ATLAS_WIDTH = 512;
+const unsigned ATLAS_FIRST_CHARACTER = 32;  // space
+const unsigned ATLAS_LAST_CHARACTER = 126;  // tilde
+const unsigned ATLAS_CHARACTER_COUNT = ATLAS_LAST_CHARACTER - ATLAS_FIRST_CHARACTER + 1;
+
+struct BakedSize
+{
+    std::uint8_t characterSize;
+    float lineSpacing;
+};
+
+// Metrics in pixels relative to the pen on the baseline, as in sf::Glyph::bounds
+struct BakedGlyph
+{
+    std::uint8_t characterSize;
+    std::uint8_t character;
+    float advance;
+    float left;
+    float top;
+    float width;
+    float height;
+    std::uint16_t x; // rendered coverage in the atlas
+    std::uint16_t y;
+    std::uint16_t pixelWidth;
+    std::uint16_t pixelHeight;
+};
+
+// Only pairs with a nonzero offset are baked
+struct BakedKerning
+{
+    std::uint8_t characterSize;
+    std::uint8_t first;
+    std::uint8_t second;
+    float offset;
+};
+
+// Defined in the generated embedded_font.cpp
+extern const unsigned BAKED_ATLAS_HEIGHT;
+extern const unsigned char BAKED_ATLAS[]; // coverage, BAKED_ATLAS_WIDTH by BAKED_ATLAS_HEIGHT
+extern const BakedSize BAKED_SIZES[];
+extern const size_t BAKED_SIZE_COUNT;
+extern const BakedGlyph BAKED_GLYPHS[];
+extern const size_t BAKED_GLYPH_COUNT;
+extern const BakedKerning BAKED_KERNING[];
+extern const size_t BAKED_KERNING_COUNT;
@@ -0,0 +1,89 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cmath>
+#include "simulation.hpp"
+
+// Draws every ball and trail point as a textured quad in one vertex array, so the
+// whole population costs a single draw call. All quads share one circle texture.
+struct BallRenderer
+{
+    sf::Texture circleTexture;
+    sf::VertexArray vertices{sf::Triangles};
+    size_t vertexCount = 0;
+
+    // Rasterizes an antialiased white disc that vertex colors tint per ball
+    bool create(unsigned resolution = 64)
+    {
+        sf::Image disc;
+        disc.create(resolution, resolution, sf::Color::Transparent);
+        float radius = resolution / 2.0f;
+        for (unsigned y = 0; y < resolution; ++y)
+        {
+            for (unsigned x = 0; x < resolution; ++x)
+            {
+                float dx = x + 0.5f - radius;
+                float dy = y + 0.5f - radius;
+                float coverage = std::min(std::max(radius - std::sqrt(dx * dx + dy * dy), 0.0f), 1.0f);
+                disc.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(coverage * 255)));
+            }
+        }
+        if (!circleTexture.loadFromImage(disc))
+            return false;
+        circleTexture.setSmooth(true);
+        return true;
+    }
+
+    void build(const RenderSnapshot &snapshot)
+    {
+        size_t quads = snapshot.ballCount();
+        for (size_t b = 0; b < snapshot.ballCount(); ++b)
+            quads += snapshot.trailSize[b];
+
+        // The array only grows, so steady-state frames reuse its storage
+        vertexCount = quads * 6;
+        if (vertices.getVertexCount() < vertexCount)
+            vertices.resize(vertexCount);
+
+        size_t v = 0;
+        const float trailRadius = BALL_RADIUS * SCALE / 2.5f;
+        for (size_t b = 0; b < snapshot.ballCount(); ++b)
+        {
+            // Trail with fading effect, oldest point first
+            int trailSize = snapshot.trailSize[b];
+            for (int i = 0; i < trailSize; ++i)
+            {
+                sf::Color trailColor = snapshot.color[b];
+                trailColor.a = static_cast<sf::Uint8>(static_cast<float>(i) / trailSize * 120);
+                appendQuad(v, snapshot.trailPoint(b, i), trailRadius, trailColor);
+                v += 6;
+            }
+        }
+
+        // Balls go after all trails so no trail covers a ball
+        for (size_t b = 0; b < snapshot.ballCount(); ++b)
+        {
+            appendQuad(v, snapshot.position[b], BALL_RADIUS * SCALE, snapshot.color[b]);
+            v += 6;
+        }
+    }
+
+    void draw(sf::RenderTarget &target) const
+    {
+        if (vertexCount > 0)
+            target.draw(&vertices[0], vertexCount, sf::Triangles, sf::RenderStates(&circleTexture));
+    }
+
+    void appendQuad(size_t v, sf::Vector2f center, float radius, sf::Color color)
+    {
+        float size = static_cast<float>(circleTexture.getSize().x);
+        sf::Vector2f topLeft(center.x - radius, center.y - radius);
+        sf::Vector2f bottomRight(center.x + radius, center.y + radius);
+
+        vertices[v + 0] = sf::Vertex(topLeft, color, sf::Vector2f(0, 0));
+        vertices[v + 1] = sf::Vertex(sf::Vector2f(bottomRight.x, topLeft.y), color, sf::Vector2f(size, 0));
+        vertices[v + 2] = sf::Vertex(bottomRight, color, sf::Vector2f(size, size));
+        vertices[v + 3] = sf::Vertex(topLeft, color, sf::Vector2f(0, 0));
+        vertices[v + 4] = sf::Vertex(bottomRight, color, sf::Vector2f(size, size));
+        vertices[v + 5] = sf::Vertex(sf::Vector2f(topLeft.x, bottomRight.y), color, sf::Vector2f(0, size));
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "simulation.hpp"
+
+// Binary snapshot of a Simulation: everything its next fixed step depends on
+// (balls, visit counts, counters, clock, RNG state, factor, jump rule and
+// the editor changes still waiting for the next cycle), and how far the
+// statistics file had got, so a restored run continues it.
+// A run restored from a checkpoint continues exactly as the original would
+// have. Scratch storage and the histogram totals are rebuilt on restore.
+
+const char CHECKPOINT_MAGIC[8] = {'S', 'S', 'R', 'C', 'K', 'P', 'T', '2'};
+const double DEFAULT_CHECKPOINT_INTERVAL = 60.0; // seconds of wall time between periodic checkpoints
+
+struct CheckpointHeader
+{
+    char magic[8];
+    std::uint32_t boxCount;
+    std::uint32_t seed;
+    std::uint64_t ballCount;
+};
+
+// Appends the snapshot of sim to out, which is cleared first. Copies memory
+// only, so it is cheap enough for the simulation thread.
+void serializeSimulation(const Simulation &sim, std::vector<char> &out);
+
+// Replaces sim, which needs no prior initialization, with the snapshot.
+// Returns false, leaving sim unspecified, if the data is not a complete checkpoint.
+bool restoreSimulation(Simulation &sim, const std::vector<char> &data);
+
+bool loadCheckpoint(Simulation &sim, const std::string &path);
+
+// Writes checkpoints on a background thread. The simulation thread serializes
+// into filling and swaps it with pending; the writer takes the newest pending
+// snapshot, writes it next to path and renames it over path, so a crash never
+// leaves a torn file. A snapshot queued while the previous one is still being
+// written replaces any that has not started.
+struct CheckpointWriter
+{
+    std::string path;
+    double interval = DEFAULT_CHECKPOINT_INTERVAL;
+    std::chrono::steady_clock::time_point lastQueued; // simulation thread only
+
+    std::vector<char> filling;
+    std::vector<char> pending;
+    std::vector<char> writing;
+    bool hasPending = false;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    std::atomic<std::uint64_t> written{0};
+};
+
+void startCheckpointWriter(CheckpointWriter &writer, const std::string &path, double interval);
+
+// Snapshots sim now and hands it to the writer thread
+void queueCheckpoint(CheckpointWriter &writer, const Simulation &sim);
+
+// Queues a checkpoint if interval has passed since the last one
+void checkpointIfDue(CheckpointWriter &writer, const Simulation &sim);
+
+// Writes whatever is still pending and joins the writer thread
+void stopCheckpointWriter(CheckpointWriter &writer);
@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <cstdint>
+#include "simulation.hpp"
+#include "simulation_view.hpp"
+#include "frame_capture.hpp"
+
+const size_t MAX_COMPARISON_PANELS = 9;
+
+struct ComparisonConfig
+{
+    float multiplicativeFactor = 1.0f;
+    int boxCount = DEFAULT_BOX_COUNT;
+    std::uint32_t seed = 0;
+};
+
+// Settings shared by every panel
+struct ComparisonOptions
+{
+    double priorPower = 0.0; // q_s = s^priorPower, built for each panel's state count
+    double noise = 0.0;
+    bool showExact = false;
+    size_t maxBalls = 0;     // 0 keeps the simulation's default
+};
+
+// One run of the comparison. Its simulation has a thread of its own, so the
+// runs share the cores instead of the render thread, and its view is drawn
+// into a render texture the size of its viewport, then composited into the window.
+struct ComparisonPanel
+{
+    Simulation sim;
+    SimulationView view;
+    sf::RenderTexture target;
+    sf::Sprite sprite;
+    std::thread thread;
+};
+
+// Panel i takes entry i of each list, and a list shorter than the longest
+// repeats its last entry. base fills in a list that is empty.
+std::vector<ComparisonConfig> makeComparisonConfigs(const std::vector<double> &factors, const std::vector<double> &states,
+                                                    const std::vector<double> &seeds, const ComparisonConfig &base);
+
+// Checks that every factor is a non-negative number, every state count a whole
+// number from 1 and every seed a whole number that fits 32 bits
+bool validComparisonLists(const std::vector<double> &factors, const std::vector<double> &states,
+                          const std::vector<double> &seeds);
+
+// Checks that makeProcess accepts the prior of every panel
+bool comparisonPriorsValid(const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options);
+
+// Checks that every factor ends its cycles under options' jump rule
+bool comparisonTerminates(const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options);
+
+// Panels side by side in the window, each runs until the window is closed.
+// Space, r, +, -, t and e go to every run; h, s and v work as in the single view.
+int runComparison(sf::RenderWindow &window, const GlyphAtlas &atlas, FrameCapture &capture,
+                  const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options);
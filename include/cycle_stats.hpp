@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "ssr_engine.hpp"
+
+// Append-only binary file of per-cycle aggregates: a fixed header followed,
+// for every finished cycle, by one CycleStatsRecord and its visitedBoxes
+// CycleVisit entries. Only boxes visited in the cycle are stored, so a record
+// stays small however many states the run has.
+
+const char CYCLE_STATS_MAGIC[8] = {'S', 'S', 'R', 'S', 'T', 'A', 'T', '1'};
+const std::uint32_t CYCLE_STATS_PARTIAL = 1u; // cycle cut short by a reset or by the end of the run
+const std::uint32_t CYCLE_STATS_RESET = 2u;   // counts and cycle numbers start over after this record
+const size_t CYCLE_STATS_BUFFER_BYTES = 1 << 16;
+const double CYCLE_STATS_FLUSH_SECONDS = 1.0; // longest a finished cycle waits in the buffer
+const std::uint32_t CYCLE_STATS_MAX_BOX_COUNT = 1u << 24; // far past the animation's; a larger header is damaged
+
+struct CycleStatsHeader
+{
+    char magic[8];
+    std::uint32_t boxCount;
+    std::uint32_t seed;
+    float multiplicativeFactor;
+    std::uint32_t reserved;
+};
+
+struct CycleStatsRecord
+{
+    std::uint32_t cycle;
+    std::uint32_t visitedBoxes;  // CycleVisit entries that follow
+    std::uint64_t steps;         // visits in this cycle
+    std::uint64_t totalSteps;    // visits since the last reset, this cycle included
+    std::uint64_t peakBalls;     // most animated balls at once
+    std::uint64_t cascadeBalls;  // balls in flight handed to the count-based cascade
+    double duration;             // animation seconds from the cycle start to its end
+    float multiplicativeFactor;
+    std::uint32_t flags;
+};
+
+struct CycleVisit
+{
+    std::uint32_t box;
+    std::uint32_t reserved;
+    std::uint64_t visits;
+};
+
+// Buffered writer owned by the simulation thread; memory stays at one buffer
+struct CycleStatsWriter
+{
+    std::FILE *file = nullptr;
+    std::vector<char> buffer;
+    size_t used = 0;
+    std::uint64_t cyclesWritten = 0;
+    std::uint64_t bytes = 0; // file length once the buffer is written, header included
+    std::chrono::steady_clock::time_point lastFlush;
+};
+
+bool openCycleStats(CycleStatsWriter &writer, const std::string &path, int boxCount, std::uint32_t seed, float multiplicativeFactor);
+
+// Reopens the file of a run restored from a checkpoint. The file must hold
+// boxCount boxes and end a record at bytes, the length the checkpoint saw;
+// records after that came from the part of the run being redone and are cut
+// off, then new records are appended. Returns false, leaving the file alone,
+// if it does not match.
+bool continueCycleStats(CycleStatsWriter &writer, const std::string &path, int boxCount, std::uint64_t bytes);
+
+// Writes the buffer and hands it to the OS, so readers see every finished cycle
+void flushCycleStats(CycleStatsWriter &writer);
+
+// Writes the record with one entry per listed box, visits indexed by box;
+// record.visitedBoxes is set from boxes.size(). Flushes when the buffer fills
+// or CYCLE_STATS_FLUSH_SECONDS have passed since the last flush.
+void writeCycleStats(CycleStatsWriter &writer, CycleStatsRecord record, const std::vector<int> &boxes,
+                     const std::vector<std::uint64_t> &visits);
+
+void closeCycleStats(CycleStatsWriter &writer);
+
+// Read-only memory-mapped view of a statistics file. A file still being
+// written can be opened; a record cut off by the writer is ignored.
+struct CycleStatsReader
+{
+    int fd = -1;
+    void *data = nullptr;
+    size_t size = 0;
+    const CycleStatsHeader *header = nullptr;
+};
+
+// Maps the file and checks every box index in it against the header's box
+// count, so readers can index by them. Returns false for a file that is not
+// a statistics file or holds an index out of range.
+bool openCycleStatsReader(CycleStatsReader &reader, const std::string &path);
+
+void closeCycleStatsReader(CycleStatsReader &reader);
+
+// Walks the records in file order. offset starts at 0 and is advanced past the
+// record; returns false at the end of the file.
+bool nextCycleStats(const CycleStatsReader &reader, size_t &offset, const CycleStatsRecord *&record,
+                    const CycleVisit *&visits);
+
+// Visit totals over the complete cycles since the last reset in the file
+EngineResult summarizeCycleStats(const CycleStatsReader &reader);
@@ -0,0 +1,74 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "simulation.hpp"
+
+const int DENSITY_CELL_PIXELS = 2;          // grid resolution, in window pixels per cell side
+const float DENSITY_DECAY_SECONDS = 0.4f;   // e-folding time of the afterglow that replaces trails
+const float DENSITY_FLOOR = 0.01f;          // decayed density below this counts as empty
+const size_t DENSITY_BALLS_PER_TASK = 65536; // balls per worker; smaller populations are scattered on the render thread
+const size_t DENSITY_AUTO_BALLS = 50000;    // populations past this are drawn as a heatmap
+
+// Helper threads that live as long as the renderer. A frame is handed to all
+// of them at once, with the render thread as worker 0: each scatters its slice
+// of balls, waits for the others, then merges its band of rows.
+struct DensityWorkers
+{
+    std::vector<std::thread> threads; // workers 1 .. count - 1
+    std::mutex mutex;
+    std::condition_variable wake;     // a new frame, a finished share or stopping
+    std::uint64_t frame = 0;          // bumped to start a frame
+    unsigned scattered = 0;           // workers past the scatter of this frame
+    unsigned merged = 0;              // workers past the merge
+    bool stopping = false;
+
+    // The frame being drawn
+    const RenderSnapshot *snapshot = nullptr;
+    size_t tilesUsed = 0;
+    float decay = 1.0f;
+
+    ~DensityWorkers();
+};
+
+// Draws the population as a density grid instead of one quad per ball, so a
+// frame costs O(window pixels) however many balls there are. Balls are
+// scattered into one private count grid per worker, in parallel, and the grids
+// are merged into a decaying density that stands in for the trails. The merged
+// grid is colored through a log-scaled palette into one texture.
+struct DensityRenderer
+{
+    int width = 0;  // cells per row
+    int height = 0; // rows
+    unsigned threads = 0;
+    std::vector<float> density;                     // decayed balls per cell
+    std::vector<std::vector<std::uint32_t>> tiles;  // per-worker scatter grids, zeroed by the merge
+    std::vector<sf::Uint8> pixels;                  // RGBA, one pixel per cell
+    std::vector<float> bandPeaks;                   // densest cell of each worker's rows
+    sf::Color palette[256];
+    float peak = 1.0f; // densest cell of the last frame, scales the palette
+    sf::Texture texture;
+    sf::Sprite sprite;
+    DensityWorkers workers; // last, so they stop before the grids they use go away
+};
+
+// Sizes the grid, tiles and palette for threads workers (0 for one per hardware
+// thread) and starts the helpers. The renderer must not move afterwards.
+void initDensityGrid(DensityRenderer &renderer, unsigned threads);
+
+// initDensityGrid plus the texture, which needs a graphics context
+bool createDensityRenderer(DensityRenderer &renderer, unsigned threads = 0);
+
+// Drops the afterglow, e.g. when the heatmap is switched on
+void clearDensity(DensityRenderer &renderer);
+
+// Decays the grid by dt seconds and adds the balls of snapshot, then colors the
+// result into pixels. The palette is scaled by the previous frame's peak so
+// the merge, decay and coloring share one pass over the grid.
+void accumulateDensity(DensityRenderer &renderer, const RenderSnapshot &snapshot, float dt);
+
+// Uploads pixels and draws them over the window
+void drawDensity(DensityRenderer &renderer, sf::RenderTarget &target);
@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "ssr_engine.hpp"
+
+// Binary log of every SSR transition of an animated run: a fixed header
+// followed by 16-byte records in the order the simulation produced them.
+
+const char EVENT_LOG_MAGIC[8] = {'S', 'S', 'R', 'L', 'O', 'G', '1', '\0'};
+const std::uint32_t BULK_VISITS_BALL = 0xFFFFFFFFu; // count-based visits, toBox holds the count
+const std::uint32_t RESET_BALL = 0xFFFFFFFEu;       // counts cleared, toBox holds the new factor's bits
+const std::uint32_t EVENT_TO_MASK = 0x00FFFFFFu;
+const std::uint32_t EVENT_SPLIT_SHIFT = 24;
+const std::uint32_t EVENT_SPLIT_MASK = 0x7Fu;
+const std::uint32_t EVENT_FIRST_FLAG = 0x80000000u; // first record of a ball leaving a box
+const size_t EVENT_LOG_BUFFER_RECORDS = 4096;
+
+struct EventLogHeader
+{
+    char magic[8];
+    std::uint32_t boxCount;
+    std::uint32_t seed;
+    float multiplicativeFactor;
+    std::uint32_t reserved;
+};
+
+// One ball jumping fromBox -> toBox. A ball that splits into k balls writes k
+// records with split count k, the first one flagged; a ball that ends or vanishes
+// writes one record with toBox == fromBox and split count 0. The visit to fromBox
+// is counted once, on the flagged record.
+struct TransitionRecord
+{
+    std::uint32_t cycle;
+    std::uint32_t ball;    // ball id, unique within a cycle
+    std::uint32_t fromBox;
+    std::uint32_t toBox;   // destination in the low 24 bits, split count and first flag above
+
+    int destination() const { return static_cast<int>(toBox & EVENT_TO_MASK); }
+    int splitCount() const { return static_cast<int>((toBox >> EVENT_SPLIT_SHIFT) & EVENT_SPLIT_MASK); }
+    bool isFirst() const { return (toBox & EVENT_FIRST_FLAG) != 0; }
+};
+
+TransitionRecord makeTransitionRecord(std::uint32_t cycle, std::uint32_t ball, int fromBox, int toBox, int splitCount, bool first);
+
+// Buffered streaming writer, owned by one thread
+struct EventLogWriter
+{
+    std::FILE *file = nullptr;
+    std::vector<TransitionRecord> buffer;
+    size_t used = 0;
+    std::uint64_t written = 0;
+};
+
+bool openEventLog(EventLogWriter &writer, const std::string &path, int boxCount, std::uint32_t seed, float multiplicativeFactor);
+
+void flushEventLog(EventLogWriter &writer);
+
+void logEvent(EventLogWriter &writer, const TransitionRecord &record);
+
+// Count-based visits can exceed 32 bits, so they are split over several records
+void logBulkVisits(EventLogWriter &writer, std::uint32_t cycle, int box, std::uint64_t count);
+
+void logReset(EventLogWriter &writer, std::uint32_t cycle, float multiplicativeFactor);
+
+void closeEventLog(EventLogWriter &writer);
+
+float resetFactor(const TransitionRecord &record);
+
+// Read-only view of a log file, memory-mapped so long runs load instantly
+struct EventLogReader
+{
+    int fd = -1;
+    void *data = nullptr;
+    size_t size = 0;
+    const EventLogHeader *header = nullptr;
+    const TransitionRecord *records = nullptr;
+    size_t count = 0;
+};
+
+void closeEventLogReader(EventLogReader &reader);
+
+// Maps the log and checks every box index in it against the header's box
+// count, so readers can index by them. Returns false for a file that is not a
+// log or holds an index out of range.
+bool openEventLogReader(EventLogReader &reader, const std::string &path);
+
+// Rebuilds the visit counts of the recorded run from its log, without simulating.
+// Counts cleared by a reset in the run are cleared here too.
+EngineResult replayEventLogStatistics(const EventLogReader &reader);
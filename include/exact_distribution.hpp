@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "ssr_process.hpp"
+
+const std::uint64_t CONVERGENCE_RESYNC_UPDATES = 1u << 22; // incremental sums are recomputed after this many updates
+const int CONVERGENCE_MIN_CYCLES = 10; // a target accuracy is not checked before this many cycles
+
+// Expected arrivals per box from startBalls balls resting on box 0 plus
+// startFlying balls already in flight from it, swept like runCascade with means
+// instead of draws. Noise offspring are not sent on; the return value is how
+// many there are.
+double sweepArrivals(const SsrProcess &process, float multiplicativeFactor, double startBalls, double startFlying,
+                     std::vector<double> &arrivals);
+
+// Expected visits of every box in one cycle, for any prior, noise and factor.
+// Returns false if there is no finite answer because the noise restarts never
+// die out. Without noise this is one O(N) sweep of expected arrivals: the mean
+// number of balls in flight is a running prefix sum of the offspring sent from
+// the boxes above, and landingHazard takes the same share of it on every box.
+// Noise jumps land like jumps from box 0 wherever they start, so they are
+// handled by a second sweep for a ball in flight from box 0, scaled by the
+// total expected restarts. For the classic process this gives 1/i for state i.
+bool exactVisits(const SsrProcess &process, float multiplicativeFactor, std::vector<double> &expected);
+
+// Distance between the visits counted so far and the exact law, updated as
+// visits arrive. The KL divergence of the counts from the exact shares is
+//   KL = (sum v log v - sum v log p) / V - log V
+// over boxes with v visits out of V, so each visit only touches two running
+// sums. L1 is taken over the histogram bins, which are few enough to sum.
+struct ConvergenceTracker
+{
+    bool valid = false;
+    std::vector<double> logShare; // by box, log of the exact share of visits, 0 where it vanishes
+    std::vector<double> binShare; // exact share of the visits per histogram bin
+    double visits = 0.0;
+    double visitsLogVisits = 0.0; // sum over boxes of v log v
+    double visitsLogShare = 0.0;  // sum over boxes of v log p
+    std::uint64_t updates = 0;    // since the sums were last recomputed
+};
+
+// Computes the exact law for process and multiplicativeFactor, its bin shares
+// for the binOfBox mapping (-1 for uncounted boxes), and the sums for visits.
+// Leaves tracker invalid and returns false if the law is not finite.
+bool resetConvergence(ConvergenceTracker &tracker, const SsrProcess &process, float multiplicativeFactor,
+                      const std::vector<int> &binOfBox, int bins, const std::vector<std::uint64_t> &visits);
+
+// Recomputes the running sums from the counts, dropping the rounding error
+// the incremental updates collect
+void resyncConvergence(ConvergenceTracker &tracker, const std::vector<std::uint64_t> &visits);
+
+inline double xLogX(double x)
+{
+    return x > 0.0 ? x * std::log(x) : 0.0;
+}
+
+// count new visits to box, which had before visits
+inline void addConvergenceVisits(ConvergenceTracker &tracker, int box, std::uint64_t before, std::uint64_t count)
+{
+    if (count == 0)
+        return;
+    double after = static_cast<double>(before + count);
+    tracker.visits += count;
+    tracker.visitsLogVisits += xLogX(after) - xLogX(static_cast<double>(before));
+    tracker.visitsLogShare += count * tracker.logShare[box];
+    tracker.updates++;
+}
+
+double klDivergence(const ConvergenceTracker &tracker);
+
+// Sum over bins of |observed share - exact share|, between 0 and 2
+double l1Distance(const ConvergenceTracker &tracker, const std::vector<std::uint64_t> &binVisits);
@@ -0,0 +1,42 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "baked_font.hpp"
+
+// Glyphs of one baked character size, indexed by character - ATLAS_FIRST_CHARACTER
+struct AtlasSize
+{
+    unsigned characterSize = 0;
+    float lineSpacing = 0.0f;
+    std::vector<sf::Glyph> glyphs;
+    std::vector<float> kerning; // first * ATLAS_CHARACTER_COUNT + second
+};
+
+// The font compiled into the binary: printable ASCII at the sizes the HUD
+// uses, rasterized by bake_font.x at build time into a single texture, so
+// startup neither looks for a font file nor runs FreeType.
+struct GlyphAtlas
+{
+    std::vector<AtlasSize> sizes;
+    sf::Texture texture; // white, alpha is coverage
+};
+
+// Fills the glyph tables only, enough to lay out text without a window
+void initGlyphAtlas(GlyphAtlas &atlas);
+
+// Fills the tables and uploads the texture
+bool createGlyphAtlas(GlyphAtlas &atlas);
+
+// Index into atlas.sizes, or -1 if the size was not baked
+int atlasSizeIndex(const GlyphAtlas &atlas, unsigned characterSize);
+
+// Glyph of a character in ATLAS_FIRST_CHARACTER .. ATLAS_LAST_CHARACTER
+inline const sf::Glyph &atlasGlyph(const AtlasSize &size, unsigned character)
+{
+    return size.glyphs[character - ATLAS_FIRST_CHARACTER];
+}
+
+inline float atlasKerning(const AtlasSize &size, unsigned first, unsigned second)
+{
+    return size.kerning[(first - ATLAS_FIRST_CHARACTER) * ATLAS_CHARACTER_COUNT + second - ATLAS_FIRST_CHARACTER];
+}
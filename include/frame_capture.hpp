@@ -0,0 +1,112 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+const size_t CAPTURE_POOL_SIZE = 8;     // frames in flight between render and encoder threads
+const unsigned MAX_PNG_ENCODERS = 4;
+
+enum class CaptureFormat
+{
+    Png,  // numbered PNG files
+    Raw,  // one file of concatenated RGBA frames
+    Pipe  // raw RGBA frames written to the stdin of an encoder process
+};
+
+struct CaptureFrame
+{
+    std::vector<sf::Uint8> pixels; // bottom-up rows, as read from OpenGL
+    unsigned width = 0;
+    unsigned height = 0;
+};
+
+enum class CaptureTaskType
+{
+    StartRecording,
+    Frame,
+    StopRecording,
+    Screenshot
+};
+
+struct CaptureTask
+{
+    CaptureTaskType type;
+    CaptureFrame *frame = nullptr;
+    std::string path;
+    unsigned width = 0; // frame size, for StartRecording
+    unsigned height = 0;
+};
+
+// Moves frame encoding off the render thread. The render thread reads the back
+// buffer into one of a fixed pool of frames and queues it; encoder threads write
+// it out and return the frame to the pool. When the pool is empty the frame is
+// dropped and counted instead of stalling the animation.
+struct FrameCapture
+{
+    CaptureFormat format = CaptureFormat::Png;
+    std::string outputPrefix = "capture";
+    std::string pipeCommand; // empty means the default ffmpeg command
+
+    std::vector<CaptureFrame> frames;
+    std::vector<CaptureFrame *> freeFrames;
+    std::deque<CaptureTask> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::thread> encoders;
+    bool stopping = false;
+
+    // Render thread only
+    bool recording = false;
+    std::uint64_t recordedFrames = 0;
+
+    std::atomic<std::uint64_t> droppedFrames{0};
+    std::atomic<std::uint64_t> writtenFrames{0};
+    std::atomic<bool> streamFailed{false}; // set by the encoder, the render thread then stops recording
+
+    // Encoder side, only touched by the single encoder used for stream formats
+    std::FILE *stream = nullptr;
+    bool streamIsPipe = false;
+};
+
+// Returns false if the stream took less than the whole frame
+bool writeBottomUpRows(std::FILE *stream, const CaptureFrame &frame);
+
+bool savePng(const CaptureFrame &frame, const std::string &path);
+
+// Opens the raw file or starts the encoder. SIGPIPE is ignored from then on,
+// so an encoder that is missing or exits early fails the next write instead of
+// killing the program. streamFailed is set if the output cannot be opened.
+void openCaptureStream(FrameCapture &capture, unsigned width, unsigned height);
+
+// Closes the output and reports an encoder that exited with an error
+void closeCaptureStream(FrameCapture &capture);
+
+void runCaptureEncoder(FrameCapture &capture);
+
+void startFrameCapture(FrameCapture &capture);
+
+void stopFrameCapture(FrameCapture &capture);
+
+void pushCaptureTask(FrameCapture &capture, CaptureTask task);
+
+size_t captureQueueDepth(FrameCapture &capture);
+
+// Reads the window's back buffer into a pooled frame. Call after drawing and
+// before display(). Returns nullptr when every frame is still being encoded.
+CaptureFrame *readWindowFrame(FrameCapture &capture, sf::RenderWindow &window);
+
+void captureScreenshot(FrameCapture &capture, sf::RenderWindow &window, const std::string &path);
+
+void toggleRecording(FrameCapture &capture, sf::RenderWindow &window);
+
+// Queues the current frame while recording, or stops the recording once the
+// encoder has failed; call once per frame before display()
+void recordFrame(FrameCapture &capture, sf::RenderWindow &window);
@@ -0,0 +1,73 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "font_atlas.hpp"
+
+const size_t HUD_NUMBER_CHARS = 64; // longest prefix, number and suffix the number setters format
+
+// One run of text in the HUD. Its glyph quads live in a fixed slot of the
+// HUD's vertex array, so relaying one label never moves another.
+struct HudLabel
+{
+    int size = -1;          // index into the atlas sizes, -1 for a size that was not baked
+    size_t firstVertex = 0;
+    size_t capacity = 0;    // characters the slot holds, longer text is cut
+    size_t vertexCount = 0; // vertices of the slot the last layout filled
+    sf::Vector2f position;
+    float rotation = 0.0f;  // degrees, about position
+    bool centered = false;  // position is the middle of the first line rather than its left end
+    bool hidden = false;
+    sf::Color color = sf::Color::White;
+    std::string text;       // reserved to capacity, so setting it never allocates
+};
+
+// Retained text layer. Labels keep their glyph geometry between frames and only
+// a label whose text, position or visibility changed is laid out again, by
+// updateHud. All sizes share the baked glyph atlas, so everything is drawn
+// with a single draw call in place of one sf::Text draw per label.
+struct Hud
+{
+    const GlyphAtlas *atlas = nullptr;
+    std::vector<sf::Vertex> vertices;
+    std::vector<HudLabel> labels;
+    std::vector<int> dirtyLabels;
+    std::vector<std::uint8_t> dirty; // per label
+};
+
+void createHud(Hud &hud, const GlyphAtlas &atlas);
+
+// Adds an empty label with room for capacity characters and returns its id.
+// Only characters and sizes in the atlas are drawn.
+int addHudLabel(Hud &hud, unsigned characterSize, sf::Color color, sf::Vector2f position, size_t capacity);
+
+// Drops labels first .. end and their vertex slots, e.g. to rebuild the
+// histogram axis. Labels added after first must not be referenced anymore.
+void removeHudLabels(Hud &hud, size_t first);
+
+void setHudText(Hud &hud, int label, const char *first, const char *last);
+void setHudText(Hud &hud, int label, const char *text);
+void setHudText(Hud &hud, int label, const std::string &text);
+void setHudPosition(Hud &hud, int label, sf::Vector2f position);
+void setHudHidden(Hud &hud, int label, bool hidden);
+
+// Number formatting into caller storage with std::to_chars, no allocation.
+// Each returns the end of what it wrote, cut at last.
+char *appendText(char *first, char *last, const char *text);
+char *formatCount(char *first, char *last, std::uint64_t value);
+char *formatFixed(char *first, char *last, double value, int decimals);
+char *formatScientific(char *first, char *last, double value, int decimals);
+
+// prefix, value and suffix, e.g. "Steps: 1234"
+void setHudCount(Hud &hud, int label, const char *prefix, std::uint64_t value, const char *suffix = "");
+void setHudFixed(Hud &hud, int label, const char *prefix, double value, int decimals, const char *suffix = "");
+
+// Lays out the labels that changed since the last call, once per frame
+void updateHud(Hud &hud);
+
+// Box around the glyphs of a label as last laid out
+sf::FloatRect hudLabelBounds(const Hud &hud, int label);
+
+// Returns the number of draw calls
+int drawHud(const Hud &hud, sf::RenderTarget &target);
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+const float JUMP_ARC_HEIGHT = 100.0f; // pixels a jump rises above the straight line at its middle
+
+// Flat views of the BallStore arrays the jump kernel reads and writes.
+// position holds x, y pairs, the layout of std::vector<sf::Vector2f>.
+struct JumpBatch
+{
+    size_t count = 0;
+    const std::uint8_t *isJumping = nullptr;
+    float *progress = nullptr;
+    const float *startX = nullptr;
+    const float *startY = nullptr;
+    const float *targetX = nullptr;
+    const float *targetY = nullptr;
+    float *position = nullptr;
+    std::uint8_t *landed = nullptr; // set to 1 for balls whose jump finished, 0 otherwise
+};
+
+enum class JumpKernel
+{
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+// Widest kernel the CPU supports, detected once
+JumpKernel selectJumpKernel();
+
+const char *jumpKernelName(JumpKernel kernel);
+
+// Advances every jumping ball by progressStep of its jump: smoothstep easing
+// between start and target plus a parabolic arc. Progress stops at 1 and the
+// ball is flagged in landed; balls that are not jumping are left untouched.
+// Returns the number of balls that landed.
+size_t advanceJumps(const JumpBatch &batch, float progressStep, JumpKernel kernel);
+
+size_t advanceJumpsScalar(const JumpBatch &batch, size_t begin, float progressStep);
@@ -0,0 +1,45 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include "simulation.hpp"
+#include "hud.hpp"
+
+const float MIN_FACTOR = 1.0f;
+const float MAX_FACTOR = 4.0f;
+const size_t EDITOR_MAX_CHARS = 10;
+const int EDIT_FIELD_COUNT = 4;
+
+enum class EditField
+{
+    Factor,
+    States,
+    Speed,
+    Seed
+};
+
+// In-window editor for the run parameters, fed from the window's events so the
+// frame loop never waits for input. F opens it on the factor, Tab moves on to
+// the next parameter, Enter sends the value to the simulation and Escape
+// closes it. Factor, state count and seed take effect at the next cycle
+// boundary, speed at once.
+struct ParameterEditor
+{
+    bool open = false;
+    EditField field = EditField::Factor;
+    std::string text;
+    sf::RectangleShape background;
+    Hud hud;
+    int label = -1;
+};
+
+void createParameterEditor(ParameterEditor &editor, const GlyphAtlas &atlas, sf::Vector2f position);
+
+// Opens the editor on field, starting from its value in snapshot
+void openParameterEditor(ParameterEditor &editor, EditField field, const RenderSnapshot &snapshot);
+
+// Takes the key and text events while the editor is open and returns true for
+// them, so the caller's shortcuts do not fire while a value is typed
+bool handleEditorEvent(ParameterEditor &editor, const sf::Event &event, const RenderSnapshot &snapshot, Simulation &sim);
+
+// Draws the open editor and returns the number of draw calls
+int drawParameterEditor(const ParameterEditor &editor, sf::RenderTarget &target);
@@ -0,0 +1,67 @@
+#pragma once
+#include <box2d/box2d.h>
+#include <vector>
+#include "ssr.hpp"
+
+struct Simulation;
+
+const float PHYSICS_GRAVITY = 20.0f;          // world units per second squared, y up
+const float PHYSICS_MAX_SUBSTEP = 1.0f / 240.0f; // Box2D steps at most this long, whatever the speed
+const int PHYSICS_VELOCITY_ITERATIONS = 6;
+const int PHYSICS_POSITION_ITERATIONS = 2;
+const float PHYSICS_LANDING_SLOPE = 2.5f;     // descent per unit of run as a ball comes down on its target
+const float PHYSICS_FLIGHT_TIMEOUT = 1.5f;    // in flight times; a ball still flying then is put on its box
+const size_t PHYSICS_MAX_BODIES = 10000;      // animated balls in physics mode
+const int PHYSICS_MAX_BOX_COUNT = 401;        // narrower steps leave less clearance than Box2D's contact skin
+const std::uint16_t PHYSICS_STAIRS_CATEGORY = 0x0001;
+const std::uint16_t PHYSICS_BALL_CATEGORY = 0x0002;
+
+// Box2D world for physics mode. The staircase is one static chain and balls
+// are dynamic circles that only collide with it, so each flight is a real
+// rigid-body trajectory while the SSR transitions stay exactly those drawn by
+// leaveBox. Only balls in flight hold a body: a ball that lands hands its body
+// back to the pool disabled, so resting balls and balls at the end cost nothing
+// in the world step and bodies are created once per peak flying population.
+struct PhysicsWorld
+{
+    b2World world{b2Vec2(0.0f, -PHYSICS_GRAVITY)};
+    b2Body *stairs = nullptr;
+    std::vector<b2Body *> freeBodies;
+    size_t bodyCount = 0;    // bodies created, in use or pooled
+    float ballRadius = 0.f;  // collision radius, narrower than the drawn ball on thin steps
+    float drawOffset = 0.f;  // drawn ball center above the body, so balls rest where restPosition puts them
+    float substep = PHYSICS_MAX_SUBSTEP; // length of the current world steps
+};
+
+// Builds the stairs of layout as a chain loop around the solid steps
+void initPhysics(PhysicsWorld &physics, const BoxLayout &layout);
+
+// initPhysics for a new layout, once every body is back in the pool. Pooled
+// bodies have the old radius, so they are destroyed with the old stairs.
+void rebuildPhysics(PhysicsWorld &physics, const BoxLayout &layout);
+
+// World position of a drawn ball at pixel position, and back
+b2Vec2 toWorld(const PhysicsWorld &physics, sf::Vector2f pixel);
+sf::Vector2f toPixels(const PhysicsWorld &physics, b2Vec2 position);
+
+// Enabled body at rest at position, from the pool when it has one
+b2Body *acquireBody(PhysicsWorld &physics, b2Vec2 position);
+
+void releaseBody(PhysicsWorld &physics, b2Body *body);
+
+// Returns the bodies of balls first .. size - 1 to the pool
+void releaseBallBodies(PhysicsWorld &physics, BallStore &balls, size_t first);
+
+// Seconds ball i takes from its jump start to its target. Flights come down
+// at PHYSICS_LANDING_SLOPE, which clears the corner of the box before the
+// target, so longer jumps fly higher and longer.
+float flightTime(const Simulation &sim, size_t i);
+
+// Gives the jumping ball i a body at its jump start, thrown so that Box2D's
+// integration of free fall brings it onto its target after flightTime
+void launchBall(Simulation &sim, size_t i);
+
+// Physics replacement for the jump kernel in stepSimulation: runs the world in
+// substeps of at most PHYSICS_MAX_SUBSTEP over simDt, lands balls whose body
+// touches the top of their target box, and launches the balls that leave a box.
+void stepPhysics(Simulation &sim, float simDt);
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+const size_t PROFILE_RING_SIZE = 4096;    // samples in flight per producer, power of two
+const int PROFILE_WINDOW = 240;           // frames behind the percentiles, 4 s at 60 FPS
+const float PROFILE_HUD_INTERVAL = 0.5f;  // seconds between overlay text updates
+
+enum class ProfilePhase
+{
+    Events,     // window event handling
+    Snapshot,   // picking up the snapshot and formatting labels
+    Histogram,  // updateHistogram
+    Draw,       // labels, histogram bars and stairs
+    Balls,      // building and drawing balls and trails
+    Capture,    // screenshot and recording read back
+    Display,    // display(), including the frame limiter's wait
+    Simulation, // fixed steps on the simulation thread
+    Count
+};
+
+const int PROFILE_PHASE_COUNT = static_cast<int>(ProfilePhase::Count);
+
+const char *profilePhaseName(ProfilePhase phase);
+
+struct ProfileSample
+{
+    ProfilePhase phase;
+    float milliseconds;
+};
+
+// Single-producer single-consumer ring of timing samples. The producer never
+// waits: when the consumer falls behind, samples are dropped and counted.
+struct ProfileRing
+{
+    ProfileSample samples[PROFILE_RING_SIZE];
+    std::atomic<size_t> head{0}; // next slot to write, producer only
+    std::atomic<size_t> tail{0}; // next slot to read, consumer only
+    std::atomic<std::uint64_t> dropped{0};
+
+    void push(const ProfileSample &sample)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == PROFILE_RING_SIZE)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        samples[h & (PROFILE_RING_SIZE - 1)] = sample;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    bool pop(ProfileSample &sample)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        sample = samples[t & (PROFILE_RING_SIZE - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Times its scope and pushes the result into ring, if there is one
+struct ScopedTimer
+{
+    ProfileRing *ring;
+    ProfilePhase phase;
+    std::chrono::steady_clock::time_point start;
+
+    ScopedTimer(ProfileRing *ring, ProfilePhase phase)
+        : ring(ring), phase(phase), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        if (ring)
+        {
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ring->push(ProfileSample{phase, ms});
+        }
+    }
+};
+
+struct ProfileFrame
+{
+    float phaseMs[PROFILE_PHASE_COUNT];
+    int drawCalls;
+    std::uint64_t allocations;
+};
+
+// Per-phase frame timings. The render and simulation threads each push into
+// their own ring; the render thread folds both into one row per frame.
+struct FrameProfiler
+{
+    ProfileRing renderSamples;
+    ProfileRing simulationSamples;
+    bool visible = false;
+
+    // Render thread only
+    int drawCalls = 0;
+    ProfileFrame recent[PROFILE_WINDOW]; // frame f is in slot f % PROFILE_WINDOW
+    std::uint64_t frameCount = 0;
+    std::ofstream csv;                   // one row per frame as it finishes, if open
+    std::vector<float> scratch;
+};
+
+// Opens csvPath for the per-frame rows, unless it is empty. Only the last
+// PROFILE_WINDOW frames are kept in memory either way. Returns false if the
+// file cannot be written.
+bool startFrameProfiler(FrameProfiler &profiler, const std::string &csvPath);
+
+// Closes the current frame: drains both rings into a new row together with the
+// frame's draw calls and allocations, appends it to the CSV and resets the draw
+// call counter
+void finishProfileFrame(FrameProfiler &profiler, std::uint64_t allocations);
+
+// p50, p95 and p99 of phase over the last PROFILE_WINDOW frames
+void profilePercentiles(FrameProfiler &profiler, ProfilePhase phase, float percentiles[3]);
+
+// Overlay text: one line per phase plus the draw call and allocation counters
+std::string formatProfileOverlay(FrameProfiler &profiler);
+
+// Flushes and closes the CSV. Returns false if a row could not be written.
+bool closeProfileCsv(FrameProfiler &profiler);
@@ -0,0 +1,282 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include "ssr.hpp"
+#include "event_log.hpp"
+#include "cycle_stats.hpp"
+#include "profiler.hpp"
+#include "jump_kernel.hpp"
+#include "exact_distribution.hpp"
+
+struct CheckpointWriter;
+struct PhysicsWorld;
+
+const float FIXED_TIMESTEP = 1.0f / 120.0f;
+const float MAX_STEP_BACKLOG = 0.25f; // seconds of simulation dropped after a stall
+const int TRAIL_SAMPLE_STEPS = 2;     // trail point every other step, 60 per second
+const float MIN_SPEED = 0.1f;
+const float MAX_SPEED = 10.0f;
+const int TURBO_STEPS_PER_TICK = 20000; // discrete SSR steps per fixed step in turbo mode
+
+// Lock-free triple buffer: the writer fills writeBuffer() and publishes it, the
+// reader swaps in the newest published buffer. Neither side ever waits, and the
+// reader always sees a complete buffer.
+template <typename T>
+struct TripleBuffer
+{
+    static const int FRESH = 4; // set on middle when it holds an unread buffer
+
+    T buffers[3];
+    int back = 0;
+    std::atomic<int> middle{1};
+    int front = 2;
+
+    T &writeBuffer() { return buffers[back]; }
+
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // Swaps in the newest published buffer, returns false if there is none
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_acquire) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    const T &readBuffer() const { return buffers[front]; }
+};
+
+// Immutable view of the simulation handed to the render thread
+struct RenderSnapshot
+{
+    std::vector<sf::Vector2f> position;
+    std::vector<sf::Color> color;
+    std::vector<sf::Vector2f> trail;
+    std::vector<int> trailHead;
+    std::vector<int> trailSize;
+    std::vector<std::uint64_t> binVisits;
+    std::vector<double> exactBinShare; // empty unless convergence is tracked
+    double klDivergence = 0.0;
+    double l1Distance = 0.0;
+    int boxCount = 0;
+    std::uint32_t seed = 0;
+    std::uint64_t stepCount = 0;
+    int cycleCount = 0;
+    float multiplicativeFactor = 1.0f;
+    float simulationSpeed = 1.0f;
+    bool isPaused = false;
+    bool turbo = false;
+
+    size_t ballCount() const { return position.size(); }
+
+    // k-th oldest trail point of ball i, same layout as BallStore
+    const sf::Vector2f &trailPoint(size_t i, int k) const
+    {
+        return trail[i * MAX_TRAIL_SIZE + (trailHead[i] + k) % MAX_TRAIL_SIZE];
+    }
+};
+
+enum class SimulationCommandType
+{
+    Reset,
+    SetFactor, // at the next cycle boundary, like SetStates and SetSeed
+    SetStates,
+    SetSeed,
+    ChangeSpeed,
+    SetSpeed,
+    TogglePause,
+    ToggleTurbo,
+    SetTrails,     // value 0 stops recording trails, e.g. while the heatmap draws the balls
+    SetConvergence // value 0 stops comparing the visits with the exact law
+};
+
+struct SimulationCommand
+{
+    SimulationCommandType type;
+    double value = 0.0; // double so that any seed fits exactly
+};
+
+// Parameters set from the window, applied by startNewCycle so the balls in
+// flight finish their cycle under the old ones. Zero means unchanged.
+struct ParameterChanges
+{
+    float multiplicativeFactor = 0.0f;
+    int boxCount = 0;
+    bool setSeed = false;
+    std::uint32_t seed = 0;
+};
+
+// Replay of a recorded event log. The transitions of the current recorded
+// cycle are indexed by (ball id, box), and balls take their moves from there
+// instead of the RNG.
+struct ReplayState
+{
+    const EventLogReader *log = nullptr;
+    size_t cursor = 0; // first record not yet indexed
+    std::unordered_map<std::uint64_t, size_t> events;
+    std::vector<size_t> bulkVisits; // count-based visits of the current cycle
+    bool finished = false;
+};
+
+// One animated SSR run. Owned by the simulation thread once it starts; the
+// render thread only pushes commands and reads snapshots.
+struct Simulation
+{
+    BoxLayout layout;
+    HistogramModel bins; // state to bin mapping and per-bin totals
+    std::vector<std::uint64_t> visits;
+    BallStore balls;
+    float multiplicativeFactor = 1.0f;
+    std::uint64_t stepCount = 0;
+    int cycleCount = 0;
+    std::uint32_t seed = 0; // the only source of randomness, so equal seeds give equal runs
+    std::mt19937 rng;
+    std::uint32_t nextBallId = 1;
+    SsrProcess process; // jump rule, the classic uniform one unless set after initSimulation
+    double priorPower = 0.0;      // rebuilds the prior when the state count changes
+    bool fixedStateCount = false; // a prior file or a replay ties the run to its state count
+    ParameterChanges pendingChanges;
+
+    float simulationSpeed = 1.0f;
+    float waitTime = 1.5f;
+    float jumpDurationBase = 0.8f;
+    float cycleWaitTime = 2.0f; // Wait 2 seconds between cycles
+    bool isPaused = false;
+    bool turbo = false; // discrete steps without jump animation
+    bool recordTrails = true;
+
+    // Animation time in seconds, advanced by the fixed step times simulationSpeed
+    double simTime = 0.0;
+    double cycleStartTime = 0.0;
+    std::uint64_t stepIndex = 0;
+
+    JumpKernel jumpKernel = JumpKernel::Scalar; // picked for the CPU by initSimulation
+    std::vector<std::uint8_t> jumpLanded;
+
+    // Scratch storage for balls advanced as counts once the animation is full
+    size_t maxAnimatedBalls = 1000;
+    std::vector<std::uint64_t> cascadePopulation;
+    std::vector<std::uint64_t> cascadeVisits;
+
+    EventLogWriter *eventLog = nullptr; // written by the simulation thread when set
+    CycleStatsWriter *cycleStats = nullptr; // gets one record per cycle when set
+    CheckpointWriter *checkpoint = nullptr; // handed a snapshot every interval when set
+    PhysicsWorld *physics = nullptr;        // jumps are Box2D flights when set
+
+    // Aggregates of the current cycle, kept only while cycleStats is set
+    std::vector<std::uint64_t> cycleVisits;
+    std::vector<int> cycleBoxes; // boxes with nonzero cycleVisits
+    std::uint64_t cycleStartSteps = 0;
+    size_t cyclePeakBalls = 0;
+    std::uint64_t cycleCascadeBalls = 0; // balls in flight handed to the cascade, counted even without cycleStats
+    std::uint64_t restoredStatsBytes = 0; // length of the statistics file at the checkpoint this run was restored from
+    ProfileRing *profileSamples = nullptr; // receives the time spent in each batch of steps
+
+    // Error of the visits against the exact law, kept while trackConvergence is set.
+    // Once the targets that are nonzero are met at a cycle boundary the run pauses.
+    bool trackConvergence = false;
+    ConvergenceTracker convergence;
+    double targetKl = 0.0;
+    double targetL1 = 0.0;
+    bool converged = false;
+    ReplayState replay;
+
+    std::mutex commandMutex;
+    std::vector<SimulationCommand> commands;
+    std::vector<SimulationCommand> pendingCommands;
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::atomic<bool> running{true};
+};
+
+void initSimulation(Simulation &sim, int boxCount, float multiplicativeFactor, std::uint32_t seed);
+
+void logTransition(Simulation &sim, std::uint32_t ball, int fromBox, int toBox, int splitCount, bool first);
+
+std::uint64_t replayKey(std::uint32_t ball, int box);
+
+// Indexes the records of the next recorded cycle. A reset in the recorded run
+// is applied when the replay reaches it.
+void loadReplayCycle(Simulation &sim);
+
+// Starts replaying log from its first cycle instead of simulating
+void startReplay(Simulation &sim, const EventLogReader &log);
+
+// Recorded move of the ball leaving box, or nullptr if the recorded run
+// handed that ball to the count-based cascade
+const TransitionRecord *findReplayEvent(const ReplayState &replay, std::uint32_t ball, int box);
+
+void countVisits(Simulation &sim, int box, std::uint64_t count);
+
+// Recomputes the exact law for the current factor and the error of the counts
+// so far, after a reset, a factor change or trackConvergence being switched on
+void refreshConvergence(Simulation &sim);
+
+// Pauses the run once it meets its accuracy targets. Checked between cycles,
+// where the counts cover whole cycles only.
+void checkConvergence(Simulation &sim);
+
+// Writes the current cycle's aggregates to cycleStats, if set, and starts new ones
+void recordCycleStats(Simulation &sim, std::uint32_t flags);
+
+void resetSimulation(Simulation &sim);
+
+// Rebuilds the layout, bins, counts and physics stairs for boxCount boxes,
+// between cycles with no balls in play. The jump rule is set by the caller.
+void resizeSimulation(Simulation &sim, int boxCount);
+
+// Applies pendingChanges. A new factor or state count changes the expected
+// distribution, so the visit counts start over as after a reset, and the event
+// log gets a reset record for replays; the cycle count keeps running.
+void applyParameterChanges(Simulation &sim);
+
+void startNewCycle(Simulation &sim);
+
+// Removes balls past maxAnimatedBalls and finishes their cycles with the
+// count-based cascade, so dropping them from the animation does not bias the
+// visit counts.
+void virtualizeBalls(Simulation &sim);
+
+// Counts the visit of ball i to the box it rests on and sends it on to the next
+// box, splitting it first. Animated children start a jump from the ball's
+// position; otherwise they land on their target at once. Returns false if the
+// ball was removed, in which case slot i now holds the store's last ball.
+bool leaveBox(Simulation &sim, size_t i, bool animate);
+
+// Returns the Box2D bodies of balls first .. size - 1, in physics mode
+void releaseBodies(Simulation &sim, size_t first);
+
+// Advances the animation by dt seconds of wall time
+void stepSimulation(Simulation &sim, float dt);
+
+// Turbo mode: runs TURBO_STEPS_PER_TICK discrete SSR steps per fixed step with
+// no waiting, jumping or trails. Cycles restart as soon as they end.
+void stepTurbo(Simulation &sim, float dt);
+
+// Lands every jumping ball on its target and drops trails, so turbo mode starts
+// from balls at rest and normal mode resumes animating from there
+void settleBalls(Simulation &sim);
+
+// Called from any thread; applied by the simulation thread before its next step
+void pushCommand(Simulation &sim, SimulationCommandType type, double value = 0.0);
+
+bool applyCommands(Simulation &sim);
+
+// Copies what the renderer needs into the back buffer and publishes it.
+// Vector assignment reuses the buffer's storage once it has grown.
+void publishSnapshot(Simulation &sim);
+
+// Simulation thread: fixed steps of FIXED_TIMESTEP wall time, decoupled from the
+// render loop, publishing a snapshot after every batch of steps. Checkpoints are
+// taken between batches, so they always fall on a step boundary.
+void runSimulation(Simulation &sim);
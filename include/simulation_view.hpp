@@ -0,0 +1,59 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "simulation.hpp"
+#include "hud.hpp"
+#include "ball_renderer.hpp"
+#include "density_renderer.hpp"
+
+// What the animation draws for one simulation: stairs, histogram, exact law
+// overlay, labels and balls, in window coordinates. The main window shows one,
+// the comparison mode one per panel.
+struct SimulationView
+{
+    Hud hud;
+    int yAxisLabel = -1;
+    int xAxisLabel = -1;
+    int stateCountLabel = -1;
+    int stepCountLabel = -1;
+    int ballCountLabel = -1;
+    int factorLabel = -1;
+    int cycleCountLabel = -1;
+    int seedLabel = -1;
+    int speedLabel = -1;
+    int pauseLabel = -1;
+    int convergenceLabel = -1;
+    size_t histogramLabels = 0; // histogram labels come last, so a new state count can replace them
+
+    HistogramModel histModel;
+    std::vector<HistogramBar> histogram;
+    sf::VertexArray histogramBars{sf::Triangles};
+    sf::VertexArray stairs;
+    sf::VertexArray exactOverlay{sf::Triangles};
+    int shownBoxCount = 0;
+
+    BallRenderer ballRenderer;
+    DensityRenderer densityRenderer; // heatmap for large populations
+    bool showHeatmap = false;
+};
+
+// Sets up the view for boxCount boxes. densityThreads is passed on to the heatmap.
+bool createSimulationView(SimulationView &view, const GlyphAtlas &atlas, int boxCount, float multiplicativeFactor,
+                          unsigned densityThreads = 0);
+
+// Rebuilds the stairs, histogram and axis for a new state count
+void setViewBoxCount(SimulationView &view, int boxCount);
+
+// Takes in a new snapshot: histogram totals, labels and the exact law overlay
+void syncSimulationView(SimulationView &view, const RenderSnapshot &snapshot);
+
+// Applies the synced visits to the bars and lays out the changed labels
+void updateSimulationView(SimulationView &view);
+
+// Histogram, overlay, labels and stairs. Returns the number of draw calls.
+int drawSimulationScene(const SimulationView &view, sf::RenderTarget &target);
+
+// Balls with their trails, or their density once heatmap is asked for or the
+// population passes DENSITY_AUTO_BALLS. Switching tells sim whether to keep trails.
+void drawSimulationBalls(SimulationView &view, Simulation &sim, sf::RenderTarget &target, bool heatmapRequested,
+                         float frameSeconds);
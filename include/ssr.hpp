@@ -1,250 +1,309 @@
 #pragma once 
 #include <SFML/Graphics.hpp>
 #include <box2d/box2d.h>
+#include "ssr_engine.hpp"
+#include "hud.hpp"
 
 const float SCALE = 30.f;
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 720;
-const int BOX_COUNT = 21.f;
-const float BOX_WIDTH = (WINDOW_WIDTH - (BOX_COUNT + 1) * 2.f) / SCALE / BOX_COUNT;
+const int DEFAULT_BOX_COUNT = 21;
+const int MAX_BOX_COUNT = 1000001;
+const float STAIR_HEIGHT = DEFAULT_BOX_COUNT * 0.6f;
 const float BALL_RADIUS = 0.5f;
 
+const float HIST_X = 20.0f;
+const float HIST_Y = 40.0f;
+const float HIST_WIDTH = 900.0f;
+const float HIST_HEIGHT = 180.0f;
+const float MIN_BAR_WIDTH = 3.0f;  // narrower bars switch the histogram to log bins
+const int LABELED_BAR_LIMIT = 40;  // above this only tick bars get a label
+const double LOG_DECADES = 6.0;    // y range of the log-binned histogram
 
-struct Ball
+// Staircase geometry for a runtime number of boxes, in world units (see SCALE)
+struct BoxLayout
 {
-    sf::Vector2f position;
-    sf::Vector2f startPos;
-    sf::Vector2f targetPos;
-    int currentBox = 0;
-    int nextBox = 0;
-    bool isJumping = false;
-    float jumpProgress = 0.0f;
-    sf::Clock timer;
-    std::vector<sf::Vector2f> trail;
-    sf::Color color = sf::Color::Green;
-    bool hasReachedEnd = false;
+    int boxCount = DEFAULT_BOX_COUNT;
+    float boxWidth = 0.f;
+    float gap = 0.f;
+    float stepHeight = 0.f;
 
-    // Default constructor
-    Ball()
-    {
-        trail.reserve(50);
-    }
+    float x(int box) const { return box * (boxWidth + gap); }
+    float height(int box) const { return (boxCount - box) * stepHeight; }
 
-    // Parameterized constructor
-    Ball(sf::Vector2f pos, int box, sf::Color col = sf::Color::Green)
-        : position(pos), currentBox(box), color(col), hasReachedEnd(false)
+    // Pixel position of a ball resting on top of box
+    sf::Vector2f restPosition(int box) const
     {
-        trail.reserve(50);
+        return sf::Vector2f(x(box) * SCALE + boxWidth * SCALE / 2.f,
+                            WINDOW_HEIGHT - height(box) * SCALE - BALL_RADIUS * SCALE);
     }
 };
 
+BoxLayout makeBoxLayout(int boxCount);
 
-struct BoxInfo
-{
-    sf::RectangleShape shape;
-    int visits = 0;
-    sf::Text countText;
-    float x;
-    float height;
-    int index;
-};
-
-struct HistogramBar
-{
-    sf::RectangleShape bar;
-    sf::Text label;
-    sf::Text valueText;
-};
 
+const int MAX_TRAIL_SIZE = 50;
 
-void createDescendingEdges(std::vector<BoxInfo> &boxes, sf::Font &font)
+// Ball data laid out as a structure of arrays. Every array is indexed by ball,
+// trails are ring buffers stored back to back in fixed slots of MAX_TRAIL_SIZE points.
+// Removal swaps the last ball into the hole, so once the arrays have grown to
+// the peak population, spawning and removing balls never allocates. Jump end
+// points are kept as separate float arrays for the vectorized jump kernel.
+struct BallStore
 {
-    float gap = 2.f / SCALE;
-    for (int i = 0; i < BOX_COUNT; ++i)
-    {
-        float x = i * (BOX_WIDTH + gap);
-        float height = (BOX_COUNT - i) * 0.6f;
-
-        sf::RectangleShape rect(sf::Vector2f(BOX_WIDTH * SCALE, height * SCALE));
-        rect.setPosition(x * SCALE, (WINDOW_HEIGHT - height * SCALE));
-        rect.setFillColor(sf::Color::White);
-        rect.setOutlineColor(sf::Color::Red);
-        rect.setOutlineThickness(2.f);
+    std::vector<sf::Vector2f> position;
+    std::vector<float> startX;
+    std::vector<float> startY;
+    std::vector<float> targetX;
+    std::vector<float> targetY;
+    std::vector<int> currentBox;
+    std::vector<int> nextBox;
+    std::vector<std::uint8_t> isJumping;
+    std::vector<float> jumpProgress;
+    std::vector<double> restStart; // simulation time the ball started waiting
+    std::vector<sf::Color> color;
+    std::vector<std::uint8_t> hasReachedEnd;
+    std::vector<std::uint32_t> id; // unique within a cycle, names the ball in the event log
+    std::vector<sf::Vector2f> trail;
+    std::vector<int> trailHead; // slot index of the oldest point
+    std::vector<int> trailSize;
+    std::vector<b2Body *> body; // rigid body while the ball flies in physics mode, owned by the PhysicsWorld
 
-        sf::Text label;
+    size_t size() const { return position.size(); }
 
-        boxes.push_back(BoxInfo{rect, 0, label, x, height, i});
+    void reserve(size_t count)
+    {
+        position.reserve(count);
+        startX.reserve(count);
+        startY.reserve(count);
+        targetX.reserve(count);
+        targetY.reserve(count);
+        currentBox.reserve(count);
+        nextBox.reserve(count);
+        isJumping.reserve(count);
+        jumpProgress.reserve(count);
+        restStart.reserve(count);
+        color.reserve(count);
+        hasReachedEnd.reserve(count);
+        id.reserve(count);
+        trail.reserve(count * MAX_TRAIL_SIZE);
+        trailHead.reserve(count);
+        trailSize.reserve(count);
+        body.reserve(count);
     }
-}
 
-float smoothStep(float t)
-{
-    return t * t * (3.0f - 2.0f * t);
-}
-
-void createHistogram(std::vector<HistogramBar> &histogram, sf::Font &font)
-{
-    const float histX = 20.0f;
-    const float histY = 40.0f;
-    const float histWidth = 900.0f;
-    const float histHeight = 180.0f;
-    const float barWidth = histWidth / (BOX_COUNT - 1);
-
-    for (int i = 0; i < BOX_COUNT - 1; ++i)
+    void clear()
     {
-        HistogramBar histBar;
-        histBar.bar.setSize(sf::Vector2f(barWidth - 2.0f, 0.0f));
-        histBar.bar.setPosition(histX + i * barWidth, histY + histHeight);
-        histBar.bar.setFillColor(sf::Color(100, 150, 255, 180));
-        histBar.bar.setOutlineColor(sf::Color::White);
-        histBar.bar.setOutlineThickness(1.0f);
-
-        // Display labels in ascending order (1, 2, 3, ..., 20) from left to right
-        int stateLabel = i + 1;
-        histBar.label.setFont(font);
-        histBar.label.setCharacterSize(7);
-        histBar.label.setFillColor(sf::Color::White);
-        histBar.label.setString(std::to_string(stateLabel));
-
-        // Center the label under each bar
-        sf::FloatRect textBounds = histBar.label.getLocalBounds();
-        float labelX = histX + i * barWidth + (barWidth - textBounds.width) / 2;
-        histBar.label.setPosition(labelX, histY + histHeight + 5);
-
-        histogram.push_back(histBar);
+        truncate(0);
     }
-}
 
-void updateHistogram(std::vector<HistogramBar> &histogram, const std::vector<BoxInfo> &boxes)
-{
-    const float histY = 40.0f;
-    const float histHeight = 180.0f;
-    int maxVisits = 1;
-    for (int i = 1; i < boxes.size(); ++i)
-        maxVisits = std::max(maxVisits, boxes[i].visits);
+    sf::Vector2f target(size_t i) const { return sf::Vector2f(targetX[i], targetY[i]); }
 
-    for (int i = 0; i < histogram.size(); ++i)
+    // Sets up a jump of ball i from start to target without starting it
+    void setJump(size_t i, sf::Vector2f start, int box, sf::Vector2f targetPos)
     {
-        // Reverse the mapping: histogram bar i (labeled as state i+1) should show data from box (BOX_COUNT - 1 - i)
-        int boxIndex = BOX_COUNT - 1 - i;
-        int visits = boxes[boxIndex].visits;
-        float barHeight = (visits > 0) ? (static_cast<float>(visits) / maxVisits) * histHeight : 0.0f;
-        histogram[i].bar.setSize(sf::Vector2f(histogram[i].bar.getSize().x, barHeight));
-        histogram[i].bar.setPosition(histogram[i].bar.getPosition().x, histY + histHeight - barHeight);
-
-        histogram[i].valueText.setString(std::to_string(visits));
-        sf::Vector2f barPos = histogram[i].bar.getPosition();
-
-        // Center the value text above each bar
-        sf::FloatRect textBounds = histogram[i].valueText.getLocalBounds();
-        float textX = barPos.x + (histogram[i].bar.getSize().x - textBounds.width) / 2;
-        float textY = barPos.y - 15;
-        if (textY < histY)
-            textY = barPos.y + 2;
-        histogram[i].valueText.setPosition(textX, textY);
+        startX[i] = start.x;
+        startY[i] = start.y;
+        targetX[i] = targetPos.x;
+        targetY[i] = targetPos.y;
+        nextBox[i] = box;
     }
-}
 
-sf::Color generateRandomColor()
-{
-    static std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> colorDist(100, 255);
-    return sf::Color(colorDist(rng), colorDist(rng), colorDist(rng));
-}
-
-std::vector<Ball> splitBall(const Ball &originalBall, float multiplicativeFactor,
-                            const std::vector<BoxInfo> &boxes, std::mt19937 &rng)
-{
-    std::vector<Ball> newBalls;
-
-    int wholePart = static_cast<int>(multiplicativeFactor);
-    float fractionalPart = multiplicativeFactor - wholePart;
+    // Appends a ball waiting on box since time and returns its index
+    size_t spawn(sf::Vector2f pos, int box, double time, sf::Color col = sf::Color::Green, std::uint32_t ballId = 0)
+    {
+        position.push_back(pos);
+        startX.push_back(pos.x);
+        startY.push_back(pos.y);
+        targetX.push_back(pos.x);
+        targetY.push_back(pos.y);
+        currentBox.push_back(box);
+        nextBox.push_back(box);
+        isJumping.push_back(0);
+        jumpProgress.push_back(0.0f);
+        restStart.push_back(time);
+        color.push_back(col);
+        hasReachedEnd.push_back(0);
+        id.push_back(ballId);
+        trail.resize(trail.size() + MAX_TRAIL_SIZE);
+        trailHead.push_back(0);
+        trailSize.push_back(0);
+        body.push_back(nullptr);
+        return position.size() - 1;
+    }
 
-    int totalBalls = wholePart;
+    // Appends a copy of ball i with an empty trail and returns its index
+    size_t spawnCopy(size_t i)
+    {
+        size_t j = spawn(position[i], currentBox[i], restStart[i], color[i], id[i]);
+        startX[j] = startX[i];
+        startY[j] = startY[i];
+        targetX[j] = targetX[i];
+        targetY[j] = targetY[i];
+        nextBox[j] = nextBox[i];
+        isJumping[j] = isJumping[i];
+        jumpProgress[j] = jumpProgress[i];
+        hasReachedEnd[j] = hasReachedEnd[i];
+        return j;
+    }
 
-    // Handle fractional part with probability
-    if (fractionalPart > 0)
+    // Moves the last ball into slot i and drops the last slot
+    void swapRemove(size_t i)
     {
-        std::uniform_real_distribution<float> probDist(0.0f, 1.0f);
-        if (probDist(rng) < fractionalPart)
+        size_t last = size() - 1;
+        if (i != last)
         {
-            totalBalls += 1;
+            position[i] = position[last];
+            startX[i] = startX[last];
+            startY[i] = startY[last];
+            targetX[i] = targetX[last];
+            targetY[i] = targetY[last];
+            currentBox[i] = currentBox[last];
+            nextBox[i] = nextBox[last];
+            isJumping[i] = isJumping[last];
+            jumpProgress[i] = jumpProgress[last];
+            restStart[i] = restStart[last];
+            color[i] = color[last];
+            hasReachedEnd[i] = hasReachedEnd[last];
+            id[i] = id[last];
+            std::copy(trail.begin() + last * MAX_TRAIL_SIZE, trail.begin() + (last + 1) * MAX_TRAIL_SIZE,
+                      trail.begin() + i * MAX_TRAIL_SIZE);
+            trailHead[i] = trailHead[last];
+            trailSize[i] = trailSize[last];
+            body[i] = body[last];
         }
+        truncate(last);
+    }
+
+    // Keeps the first count balls
+    void truncate(size_t count)
+    {
+        position.resize(count);
+        startX.resize(count);
+        startY.resize(count);
+        targetX.resize(count);
+        targetY.resize(count);
+        currentBox.resize(count);
+        nextBox.resize(count);
+        isJumping.resize(count);
+        jumpProgress.resize(count);
+        restStart.resize(count);
+        color.resize(count);
+        hasReachedEnd.resize(count);
+        id.resize(count);
+        trail.resize(count * MAX_TRAIL_SIZE);
+        trailHead.resize(count);
+        trailSize.resize(count);
+        body.resize(count);
     }
 
-    // Create the new balls
-    for (int i = 0; i < totalBalls; ++i)
+    // Appends a trail point, overwriting the oldest once the slot is full
+    void pushTrail(size_t i, sf::Vector2f point)
     {
-        Ball newBall = originalBall;
-        if (multiplicativeFactor > 1)
+        sf::Vector2f *slot = &trail[i * MAX_TRAIL_SIZE];
+        if (trailSize[i] < MAX_TRAIL_SIZE)
         {
-            newBall.color = generateRandomColor();
+            slot[(trailHead[i] + trailSize[i]) % MAX_TRAIL_SIZE] = point;
+            trailSize[i]++;
         }
         else
         {
-            newBall.color = sf::Color::Green;
+            slot[trailHead[i]] = point;
+            trailHead[i] = (trailHead[i] + 1) % MAX_TRAIL_SIZE;
         }
-        newBall.trail.clear();
-        newBall.hasReachedEnd = false;
+    }
 
-        // Add slight position offset for visual separation
-        float offsetX = (i - totalBalls / 2.0f) * 5.0f;
-        newBall.position.x += offsetX;
+    void clearTrail(size_t i)
+    {
+        trailHead[i] = 0;
+        trailSize[i] = 0;
+    }
 
-        newBalls.push_back(newBall);
+    // k-th oldest trail point of ball i
+    const sf::Vector2f &trailPoint(size_t i, int k) const
+    {
+        return trail[i * MAX_TRAIL_SIZE + (trailHead[i] + k) % MAX_TRAIL_SIZE];
     }
+};
 
-    return newBalls;
-}
 
-void resetSimulation(std::vector<BoxInfo> &boxes, std::vector<HistogramBar> &histogram,
-                     std::vector<Ball> &balls, int &stepCount, int &cycleCount, const std::vector<BoxInfo> &originalBoxes)
+// Bar geometry in window pixels. Axis label and count of a bar are HUD labels,
+// -1 for a bar without one.
+struct HistogramBar
 {
-    // Reset all visit counts
-    for (auto &box : boxes)
-    {
-        box.visits = 0;
-    }
+    float left = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    bool outlined = false; // wide bars get a one pixel white border
+    int label = -1;
+    int valueText = -1;
+};
 
-    // Reset histogram
-    updateHistogram(histogram, boxes);
 
-    // Clear all balls and create initial ball
-    balls.clear();
-    sf::Vector2f initialPos;
-    initialPos.x = originalBoxes[0].x * SCALE + BOX_WIDTH * SCALE / 2.f;
-    initialPos.y = WINDOW_HEIGHT - originalBoxes[0].height * SCALE - BALL_RADIUS * SCALE;
-    balls.push_back(Ball(initialPos, 0));
+void appendRect(sf::VertexArray &vertices, float left, float top, float width, float height, sf::Color color);
 
-    // Reset counters
-    stepCount = 0;
-    cycleCount = 0;
-}
+// Builds the staircase as one triangle array. Boxes wider than a few pixels get
+// their own outlined rectangle; narrower ones are merged into one column per
+// pixel, so the geometry is bounded by the window width rather than the box count.
+void createDescendingEdges(sf::VertexArray &stairs, const BoxLayout &layout);
 
-void startNewCycle(std::vector<Ball> &balls, const std::vector<BoxInfo> &boxes, int &cycleCount)
+inline float smoothStep(float t)
 {
-    // Clear all balls and create new initial ball
-    balls.clear();
-    sf::Vector2f initialPos;
-    initialPos.x = boxes[0].x * SCALE + BOX_WIDTH * SCALE / 2.f;
-    initialPos.y = WINDOW_HEIGHT - boxes[0].height * SCALE - BALL_RADIUS * SCALE;
-    balls.push_back(Ball(initialPos, 0));
-    cycleCount++;
-
-    // std::cout << "Starting cycle " << cycleCount << std::endl;
+    return t * t * (3.0f - 2.0f * t);
 }
 
-float getUserMultiplicativeFactor()
+// Groups states into histogram bins and tracks what changed since the last
+// updateHistogram call. Up to HIST_WIDTH / MIN_BAR_WIDTH states get one bar each;
+// beyond that states are grouped into log-spaced bins showing the mean visits per
+// state on a log scale, so the bar count depends on pixel width and not on N.
+struct HistogramModel
 {
-    float factor{1.0f}; // default
-    std::cout << "Enter multiplicative factor (e.g., 2.0 for doubling, 1.5 for 50% chance of +1 ball): ";
-    std::cin >> factor;
-
-    if (factor < 1.0f)
-        factor = 1.0f; // minimum bound
-    if (factor > 4.0f)
-        factor = 4.0f; // maximum bound
-
-    std::cout << "Using multiplicative factor: " << factor << std::endl;
-    return factor;
-}
\ No newline at end of file
+    bool logBinned = false;
+    std::vector<int> binOfBox;         // -1 for box 0, which is never counted
+    std::vector<int> binFirstState;    // bin b holds states binFirstState[b] .. binFirstState[b + 1] - 1
+    std::vector<std::uint64_t> binVisits;
+    double maxValue = 1.0;             // largest mean visits per state over all bins
+    bool rescale = true;               // maxValue changed, every bar height moves
+    std::vector<std::uint8_t> dirty;   // per bin, visit count changed
+    std::vector<int> dirtyBins;
+
+    int binCount() const { return static_cast<int>(binVisits.size()); }
+
+    double binValue(int bin) const
+    {
+        return static_cast<double>(binVisits[bin]) / (binFirstState[bin + 1] - binFirstState[bin]);
+    }
+};
+
+void createHistogramModel(HistogramModel &model, int boxCount);
+
+// Copies the per-bin totals published by the simulation and marks the bins that changed
+void syncHistogramModel(HistogramModel &model, const std::vector<std::uint64_t> &binVisits);
+
+float histogramBarHeight(const HistogramModel &model, double value);
+
+// States that get an axis label once there are too many bars to label all of them
+bool isTickState(const HistogramModel &model, int state, int states);
+
+// Adds the bar labels to hud, after its other labels so a rebuild can drop them
+void createHistogram(std::vector<HistogramBar> &histogram, sf::VertexArray &bars, const HistogramModel &model, Hud &hud);
+
+void layoutHistogramBar(HistogramBar &histBar, float barHeight, Hud &hud);
+
+// Rebuilds bars as one triangle array, so the histogram is a single draw call
+// whatever its bar count
+void appendHistogramBars(sf::VertexArray &bars, const std::vector<HistogramBar> &histogram);
+
+// Applies the changes recorded in model, once per frame
+void updateHistogram(std::vector<HistogramBar> &histogram, sf::VertexArray &bars, HistogramModel &model, Hud &hud);
+
+// One marker per bar at the height the exact law predicts for the visits
+// counted so far, on the same scale as the bars
+void layoutExactOverlay(sf::VertexArray &overlay, const HistogramModel &model, const std::vector<double> &binShare);
+
+sf::Color generateRandomColor(std::mt19937 &rng);
+
+// Splits ball i in place into totalBalls children: the ball keeps its slot as the
+// first child and the others are appended to the store. Returns the number of
+// children, which are i followed by the last (count - 1) balls of the store.
+int splitBall(BallStore &balls, size_t i, int totalBalls, float multiplicativeFactor, std::mt19937 &rng);
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include "ssr_process.hpp"
+
+// Headless SSR engine: same process as splitBall/startNewCycle, without SFML.
+// Boxes are indexed like boxes[i] in the animation: box 0 is the start state,
+// box boxCount - 1 is the final state, and a ball always jumps to a higher box.
+
+enum class EngineMode
+{
+    Particle,  // one entry per ball, like the animation
+    Cascade    // one occupancy count per box
+};
+
+struct EngineConfig
+{
+    EngineMode mode = EngineMode::Particle;
+    int boxCount = 21;
+    float multiplicativeFactor = 1.0f;
+    std::uint64_t cycles = 1000000;
+    unsigned threads = 0; // 0 means one per hardware thread
+    std::uint32_t seed = 0;
+    std::vector<double> prior; // weight per state, state 1 first; empty for the uniform prior
+    double noise = 0.0;        // noisy SSR: probability of a jump to any state
+};
+
+struct EngineResult
+{
+    std::vector<std::uint64_t> visits; // visits[i] matches boxes[i].visits
+    std::uint64_t steps = 0;
+    std::uint64_t cycles = 0;
+    double seconds = 0.0;
+};
+
+// Number of balls a ball splits into: floor(mu) plus one more with probability frac(mu)
+int splitCount(float multiplicativeFactor, std::mt19937 &rng);
+
+// Runs one cycle from box 0 until every ball has reached the last box.
+// pending is scratch storage for the boxes balls are about to land on.
+std::uint64_t runParticleCycle(std::vector<std::uint64_t> &visits, const SsrProcess &process, float multiplicativeFactor,
+                               std::mt19937 &rng, std::vector<int> &pending);
+
+// Advances whole populations instead of single balls. population[i] holds balls
+// that have landed on box i and have not been counted yet; it is left empty.
+// A ball in flight from any box below j lands on j with probability landingHazard(j)
+// (1 / (boxCount - j) for the uniform prior) given it did not land earlier, so all
+// in-flight balls share one binomial per box and a sweep costs O(boxCount) however
+// many balls it holds. Noise jumps start over from box 0 in another sweep.
+std::uint64_t runCascade(std::vector<std::uint64_t> &population, std::vector<std::uint64_t> &visits,
+                         const SsrProcess &process, float multiplicativeFactor, std::mt19937 &rng);
+
+// Seeds one independent stream per worker from the run seed and the worker index
+std::mt19937 makeWorkerRng(std::uint32_t seed, unsigned worker);
+
+unsigned resolveThreadCount(unsigned requested);
+
+// Runs cycles one after another on the calling thread, in the mode of config
+std::uint64_t runCycles(const EngineConfig &config, const SsrProcess &process, std::uint64_t cycles,
+                        std::mt19937 &rng, std::vector<std::uint64_t> &visits);
+
+// Runs config.cycles cycles spread over the workers. Returns false, running
+// nothing, if makeProcess refuses the prior.
+bool runEngine(const EngineConfig &config, EngineResult &result);
+
+// Largest per-box z-score between two runs of the same process, treating each
+// box's visits per cycle as an independent estimate of the same mean
+double maxVisitZScore(const EngineResult &a, const EngineResult &b);
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <random>
+
+// Transition rule of an SSR run, in box terms (box 0 is the start state, a
+// ball on box b normally jumps to a box t > b):
+//   prior weights  the jump lands on t with probability q_t / sum_{k>b} q_k,
+//                  which gives visit probabilities proportional to q instead of Zipf
+//   noise lambda   with probability lambda the jump ignores the current box and
+//                  lands anywhere in boxes 1 .. boxCount - 1, drawn from the same prior
+// The default is the classic process: uniform prior, no noise.
+struct SsrProcess
+{
+    int boxCount = 0;
+    bool uniform = true;
+    double noise = 0.0;
+    std::vector<double> cumulative; // by state: cumulative[s] = q_1 + ... + q_s, cumulative[0] = 0
+    std::vector<int> guide;         // guide[g]: first state whose cumulative weight passes g / guide.size() of the total
+};
+
+// Classic SSR over boxCount boxes
+SsrProcess makeUniformProcess(int boxCount);
+
+// stateWeights[s - 1] is the prior weight of state s = boxCount - box, for
+// states 1 .. boxCount - 1. An empty vector means the uniform prior.
+// Returns false if a weight is negative or state 1 has none, since a ball
+// next to the end could not land anywhere; this keeps every landing hazard and
+// restricted draw well defined.
+bool makeProcess(SsrProcess &process, int boxCount, const std::vector<double> &stateWeights, double noise);
+
+// q_s = s^exponent for states 1 .. states; exponent 0 is the uniform prior
+std::vector<double> powerPrior(int states, double exponent);
+
+// One weight per line, state 1 first
+bool loadPriorWeights(const std::string &path, std::vector<double> &weights);
+
+// Weight of the box, as given to makeProcess
+double boxWeight(const SsrProcess &process, int box);
+
+// Probability that a ball in flight from below box lands on it, given it did
+// not land on an earlier box. The same for every origin, which is what lets the
+// count-based cascade move whole populations.
+double landingHazard(const SsrProcess &process, int box);
+
+// Box the ball on box jumps to. Uniform, noise-free processes draw exactly as
+// std::uniform_int_distribution(box + 1, boxCount - 1) did, so seeds keep their runs.
+int sampleTarget(const SsrProcess &process, int box, std::mt19937 &rng);
+
+// Restricted draw from the prior: one uniform variate mapped through the
+// cumulative weights of the states below the ball. Sums start at state 1 so the
+// small weights near the end keep their precision. Draws are O(log N) in the
+// worst case, not O(1): the guide table only picks the starting state, which is
+// usually the answer or a few steps from it, and a scan that runs past
+// GUIDE_SCAN_LIMIT steps finishes with a binary search.
+int samplePriorTarget(const SsrProcess &process, int box, std::mt19937 &rng);
+
+// Expected noise jumps produced by one noise jump: a single ball in flight from
+// box 0, followed until its descendants reach the last box or jump by noise
+// themselves. Every noise jump starts a new such lineage, so a cycle only ends
+// if this is below 1; at 1 or above (noise with mu > 1 on enough states) the
+// population grows without bound. Matches the test exactVisits makes.
+double noiseRestartMean(const SsrProcess &process, float multiplicativeFactor);
+
+bool cycleTerminates(const SsrProcess &process, float multiplicativeFactor);
+
+// Short description for output headers, e.g. "uniform" or "prior noise 0.1"
+std::string describeProcess(const SsrProcess &process);
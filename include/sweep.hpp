@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <ostream>
+#include "ssr_engine.hpp"
+
+const int SWEEP_BINS_PER_DECADE = 10; // log-spaced state bins the exponent is fitted on
+
+// Grid of runs: every factor with every state count. The other settings of
+// base (mode, cycles, seed, noise, prior weights) apply to each run.
+struct SweepConfig
+{
+    EngineConfig base;
+    std::vector<float> factors;
+    std::vector<int> stateCounts;
+    double priorPower = 0.0; // q_s = s^priorPower, rebuilt for each state count
+    int batches = 32;        // cycles of one run are split into batches, resampled by the bootstrap
+    int bootstrap = 200;     // resamples for the confidence interval
+};
+
+struct SweepRow
+{
+    float multiplicativeFactor = 1.0f;
+    int states = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t steps = 0;
+    double exponent = 0.0;     // visits per cycle fall off like state^-exponent
+    double exponentLow = 0.0;  // 95% bootstrap interval
+    double exponentHigh = 0.0;
+    double cpuSeconds = 0.0;   // thread CPU time, summed over the run's batches
+};
+
+// Jump rule of the grid point with the given state count. Returns false if
+// makeProcess refuses the prior.
+bool makeSweepProcess(SsrProcess &process, const SweepConfig &config, int states);
+
+// Runs the grid on a work-stealing pool, one task per batch, then fits and
+// bootstraps every run. Rows come back in grid order, factors outermost.
+// Returns no rows, running nothing, if a grid point's jump rule is refused.
+std::vector<SweepRow> runSweep(const SweepConfig &config);
+
+// Weighted least squares fit of log visits per state against log state over
+// log-spaced bins, weighted by each bin's visits. binVisits[b] covers states
+// binEdges[b] .. binEdges[b + 1] - 1. Returns 0 with fewer than two nonempty bins.
+double fitPowerLawExponent(const std::vector<int> &binEdges, const std::vector<std::uint64_t> &binVisits);
+
+// Bin edges over states 1 .. states, one bin per state until the bins widen
+std::vector<int> makeLogStateBins(int states);
+
+// Comma-separated numbers, e.g. 1,1.5,2, as the sweep and comparison options
+// take them. Empty if an entry is not a number.
+std::vector<double> parseList(const char *value);
+
+void writeSweepTable(const SweepConfig &config, const std::vector<SweepRow> &rows, std::ostream &out);
@@ -0,0 +1,19 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// One worker's share of the tasks. The owner takes from the back, idle
+// workers steal from the front, so a stolen task is the one queued longest.
+struct TaskQueue
+{
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+};
+
+// Runs every task on a work-stealing pool of threads workers (0 for one per
+// hardware thread) and returns once all have finished. Tasks are dealt out
+// round-robin; a worker whose queue runs dry steals from the others, so long
+// and short tasks can be mixed freely.
+void runTasks(std::vector<std::function<void()>> &tasks, unsigned threads);
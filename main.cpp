@@ -9,373 +9,496 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <thread>
 #include"./include/ssr.hpp"
+#include"./include/simulation.hpp"
+#include"./include/ball_renderer.hpp"
+#include"./include/density_renderer.hpp"
+#include"./include/frame_capture.hpp"
+#include"./include/event_log.hpp"
+#include"./include/profiler.hpp"
+#include"./include/checkpoint.hpp"
+#include"./include/physics.hpp"
+#include"./include/parameter_editor.hpp"
+#include"./include/simulation_view.hpp"
+#include"./include/comparison.hpp"
+#include"./include/sweep.hpp"
+#include"./include/allocation_counter.hpp"
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [--states N] [--seed S] [--max-balls B] [--physics B] [--prior-power A | --prior FILE] [--noise LAMBDA]\n"
+              << "       " << program << "     [--record-format png|raw|pipe] [--record-prefix NAME] [--record-command CMD]\n"
+              << "       " << program << "     [--record-events FILE] [--record-stats FILE] [--replay FILE] [--profile-csv FILE]\n"
+              << "       " << program << "     [--checkpoint FILE] [--checkpoint-interval SECONDS] [--restore FILE] [--target-kl E] [--target-l1 E]\n"
+              << "       " << program << "     [--compare-factors MU,MU,...] [--compare-states N,N,...] [--compare-seeds S,S,...]\n";
+}
+
+int main(int argc, char **argv)
+{
+    // Number of states can be set with --states N, recording output with --record-*
+    int boxCount = DEFAULT_BOX_COUNT;
+    FrameCapture capture;
+    std::uint32_t seed = std::random_device{}();
+    std::string eventLogPath, replayPath, profileCsvPath, priorPath, statsPath, checkpointPath, restorePath;
+    double priorPower = 0.0, noise = 0.0, checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL, targetKl = 0.0, targetL1 = 0.0;
+    size_t physicsBodies = 0, maxBalls = 0;
+    std::vector<double> compareFactors, compareStates, compareSeeds;
+    bool badCompareList = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
 
+        const char *value = argv[++i];
+        if (arg == "--states")
+            boxCount = std::min(std::max(std::atoi(value) + 1, 2), MAX_BOX_COUNT);
+        else if (arg == "--record-format")
+        {
+            std::string format = value;
+            if (format == "png")
+                capture.format = CaptureFormat::Png;
+            else if (format == "raw")
+                capture.format = CaptureFormat::Raw;
+            else if (format == "pipe")
+                capture.format = CaptureFormat::Pipe;
+            else
+            {
+                printUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if (arg == "--record-prefix")
+            capture.outputPrefix = value;
+        else if (arg == "--record-command")
+        {
+            capture.format = CaptureFormat::Pipe;
+            capture.pipeCommand = value;
+        }
+        else if (arg == "--seed")
+            seed = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--record-events")
+            eventLogPath = value;
+        else if (arg == "--record-stats")
+            statsPath = value;
+        else if (arg == "--checkpoint")
+            checkpointPath = value;
+        else if (arg == "--checkpoint-interval")
+            checkpointInterval = std::max(std::strtod(value, nullptr), 1.0);
+        else if (arg == "--restore")
+            restorePath = value;
+        else if (arg == "--replay")
+            replayPath = value;
+        else if (arg == "--profile-csv")
+            profileCsvPath = value;
+        else if (arg == "--prior-power")
+            priorPower = std::strtod(value, nullptr);
+        else if (arg == "--prior")
+            priorPath = value;
+        else if (arg == "--noise")
+            noise = std::strtod(value, nullptr);
+        else if (arg == "--max-balls")
+            maxBalls = std::strtoul(value, nullptr, 10);
+        else if (arg == "--physics")
+            physicsBodies = std::min<size_t>(std::strtoul(value, nullptr, 10), PHYSICS_MAX_BODIES);
+        else if (arg == "--target-kl")
+            targetKl = std::strtod(value, nullptr);
+        else if (arg == "--target-l1")
+            targetL1 = std::strtod(value, nullptr);
+        else if (arg == "--compare-factors")
+        {
+            compareFactors = parseList(value);
+            badCompareList = badCompareList || compareFactors.empty();
+        }
+        else if (arg == "--compare-states")
+        {
+            compareStates = parseList(value);
+            badCompareList = badCompareList || compareStates.empty();
+        }
+        else if (arg == "--compare-seeds")
+        {
+            compareSeeds = parseList(value);
+            badCompareList = badCompareList || compareSeeds.empty();
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
 
-int main()
-{
-    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "SSR Simulation");
-    window.setFramerateLimit(60);
+    // Several runs side by side, each on its own thread, for the same window
+    if (badCompareList || !validComparisonLists(compareFactors, compareStates, compareSeeds))
+    {
+        std::cout << "Compared factors must be non-negative numbers, states whole numbers from 1 and seeds whole numbers below 2^32\n";
+        return -1;
+    }
+    ComparisonConfig compareBase;
+    compareBase.boxCount = boxCount;
+    compareBase.seed = seed;
+    std::vector<ComparisonConfig> comparison = makeComparisonConfigs(compareFactors, compareStates, compareSeeds, compareBase);
+    ComparisonOptions compareOptions;
+    compareOptions.priorPower = priorPower;
+    compareOptions.noise = noise;
+    compareOptions.showExact = targetKl > 0.0 || targetL1 > 0.0;
+    compareOptions.maxBalls = maxBalls;
+    if (!comparison.empty())
+    {
+        if (!comparisonPriorsValid(comparison, compareOptions))
+        {
+            std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+            return -1;
+        }
+        if (!comparisonTerminates(comparison, compareOptions))
+        {
+            std::cout << "A compared factor never ends its cycles with noise " << noise << "\n";
+            return -1;
+        }
+        if (!replayPath.empty() || !restorePath.empty() || !eventLogPath.empty() || !statsPath.empty() ||
+            !checkpointPath.empty() || !priorPath.empty() || physicsBodies > 0)
+            std::cout << "Replay, checkpoints, event logs, statistics, prior files and physics are off in comparison mode\n";
+
+        sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "SSR Comparison");
+        window.setFramerateLimit(60);
+        GlyphAtlas glyphAtlas;
+        if (!createGlyphAtlas(glyphAtlas))
+            return -1;
+        return runComparison(window, glyphAtlas, capture, comparison, compareOptions);
+    }
 
-    sf::Font font;
-    if (!font.loadFromFile("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"))
+    // A replay takes its state count and seed from the log
+    EventLogReader replayLog;
+    if (!replayPath.empty())
     {
-        if (!font.loadFromFile("C:/Windows/Fonts/arial.ttf") &&
-            !font.loadFromFile("/System/Library/Fonts/Arial.ttf"))
+        if (!openEventLogReader(replayLog, replayPath) || replayLog.header->boxCount > static_cast<std::uint32_t>(MAX_BOX_COUNT))
         {
+            std::cout << "Could not read event log " << replayPath << "\n";
             return -1;
         }
+        boxCount = static_cast<int>(replayLog.header->boxCount);
+        seed = replayLog.header->seed;
     }
+    std::cout << "Seed: " << seed << "\n";
+
+    std::vector<double> prior;
+    if (!priorPath.empty() && !loadPriorWeights(priorPath, prior))
+    {
+        std::cout << "Could not read prior weights from " << priorPath << "\n";
+        return -1;
+    }
+
+    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "SSR Simulation");
+    window.setFramerateLimit(60);
+
+    // Glyphs baked into the binary at build time
+    GlyphAtlas glyphAtlas;
+    if (!createGlyphAtlas(glyphAtlas))
+        return -1;
 
     // Get multiplicative factor from user
     float multiplicativeFactor{1.0f};
 
-    std::vector<BoxInfo> boxes;
-    boxes.reserve(BOX_COUNT);
-    createDescendingEdges(boxes, font);
-
-    std::vector<HistogramBar> histogram;
-    histogram.reserve(BOX_COUNT - 1);
-    createHistogram(histogram, font);
-
-    sf::Text histTitle, yAxisLabel, xAxisLabel;
-
-    yAxisLabel.setFont(font);
-    yAxisLabel.setCharacterSize(10);
-    yAxisLabel.setFillColor(sf::Color::White);
-    yAxisLabel.setString("Count");
-    yAxisLabel.setPosition(5, 120);
-    yAxisLabel.setRotation(-90);
-
-    xAxisLabel.setFont(font);
-    xAxisLabel.setCharacterSize(10);
-    xAxisLabel.setFillColor(sf::Color::White);
-    xAxisLabel.setString("State");
-
-    // Center the x-axis label under the histogram
-    const float histX = 20.0f;
-    const float histWidth = 900.0f;
-    sf::FloatRect xLabelBounds = xAxisLabel.getLocalBounds();
-    float xLabelX = histX + (histWidth - xLabelBounds.width) / 2;
-    xAxisLabel.setPosition(xLabelX, 240);
-
-    // Add labels in top right
-    sf::Text stateCountLabel, stepCountLabel, ballCountLabel, factorLabel, cycleCountLabel;
-
-    stateCountLabel.setFont(font);
-    stateCountLabel.setCharacterSize(16);
-    stateCountLabel.setFillColor(sf::Color::White);
-    stateCountLabel.setString("States: " + std::to_string(BOX_COUNT - 1));
-    stateCountLabel.setPosition(WINDOW_WIDTH - 160, 20);
-
-    stepCountLabel.setFont(font);
-    stepCountLabel.setCharacterSize(16);
-    stepCountLabel.setFillColor(sf::Color(200, 255, 200));
-    stepCountLabel.setString("Steps: 0");
-    stepCountLabel.setPosition(WINDOW_WIDTH - 160, 42);
-
-    ballCountLabel.setFont(font);
-    ballCountLabel.setCharacterSize(16);
-    ballCountLabel.setFillColor(sf::Color(255, 200, 200));
-    ballCountLabel.setString("Balls: 1");
-    ballCountLabel.setPosition(WINDOW_WIDTH - 160, 64);
-
-    factorLabel.setFont(font);
-    factorLabel.setCharacterSize(16);
-    factorLabel.setFillColor(sf::Color(200, 200, 255));
-    factorLabel.setString("Factor: " + std::to_string(multiplicativeFactor).substr(0, 4));
-    factorLabel.setPosition(WINDOW_WIDTH - 160, 86);
-
-    cycleCountLabel.setFont(font);
-    cycleCountLabel.setCharacterSize(16);
-    cycleCountLabel.setFillColor(sf::Color(255, 255, 200));
-    cycleCountLabel.setString("Cycles: 0");
-    cycleCountLabel.setPosition(WINDOW_WIDTH - 160, 108);
-
-    int stepCount = 0;
-    int cycleCount = 0;
-
-    // Add speed control variables
-    float simulationSpeed = 1.0f;
-    const float minSpeed = 0.1f;
-    const float maxSpeed = 10.0f;
-    float waitTime = 1.5f;
-    float jumpDurationBase = 0.8f;
-    bool isPaused = false;
-
-    sf::Text speedLabel;
-    speedLabel.setFont(font);
-    speedLabel.setCharacterSize(13);
-    speedLabel.setFillColor(sf::Color(255, 215, 0));
-    speedLabel.setString("Speed: 1.0x");
-    speedLabel.setPosition(WINDOW_WIDTH - 400, 264);
-
-    sf::Text pauseLabel;
-    pauseLabel.setFont(font);
-    pauseLabel.setCharacterSize(13);
-    pauseLabel.setFillColor(sf::Color(255, 100, 100));
-    pauseLabel.setString("");
-    pauseLabel.setPosition(WINDOW_WIDTH - 400, 280);
-
-    // Initialize balls vector
-    std::vector<Ball> balls;
-    sf::Vector2f initialPos;
-    initialPos.x = boxes[0].x * SCALE + BOX_WIDTH * SCALE / 2.f;
-    initialPos.y = WINDOW_HEIGHT - boxes[0].height * SCALE - BALL_RADIUS * SCALE;
-    balls.push_back(Ball(initialPos, 0));
-
-    const size_t maxTrailSize = 50;
-    sf::CircleShape ballShape(BALL_RADIUS * SCALE);
-    ballShape.setOrigin(BALL_RADIUS * SCALE, BALL_RADIUS * SCALE);
-
-    sf::Clock frameTimer;
-    sf::Clock cycleWaitTimer;
-    std::mt19937 rng(std::random_device{}());
-    const float cycleWaitTime = 2.0f; // Wait 2 seconds between cycles
+    // The simulation runs on its own thread and publishes snapshots for drawing
+    Simulation sim;
+    initSimulation(sim, boxCount, multiplicativeFactor, seed);
 
-    while (window.isOpen())
+    if (priorPath.empty() && priorPower != 0.0)
+        prior = powerPrior(boxCount - 1, priorPower);
+    if (!makeProcess(sim.process, boxCount, prior, noise))
+    {
+        std::cout << "Prior weights must be non-negative, and state 1 needs a positive weight\n";
+        return -1;
+    }
+    std::cout << "Process: " << describeProcess(sim.process) << "\n";
+    sim.priorPower = priorPath.empty() ? priorPower : 0.0;
+    sim.fixedStateCount = !priorPath.empty() || replayLog.records;
+
+    // A checkpoint brings its own state count, seed, factor and jump rule
+    if (!restorePath.empty() && replayLog.records)
+        std::cout << "Checkpoints are not restored during replay\n";
+    else if (!restorePath.empty())
     {
-        sf::Event event;
-        while (window.pollEvent(event))
+        if (!loadCheckpoint(sim, restorePath))
         {
-            if (event.type == sf::Event::Closed)
-                window.close();
-            if (event.type == sf::Event::KeyPressed)
-            {
-                if (event.key.code == sf::Keyboard::S)
-                {
-                    sf::Texture texture;
-                    texture.create(window.getSize().x, window.getSize().y);
-                    texture.update(window);
-
-                    auto now = std::time(nullptr);
-                    std::tm *tm_ptr = std::localtime(&now);
-                    std::ostringstream oss;
-                    oss << "screenshot_" << std::put_time(tm_ptr, "%Y%m%d_%H%M%S") << ".png";
-
-                    sf::Image screenshot = texture.copyToImage();
-                    screenshot.saveToFile(oss.str());
-                    std::cout << "Screenshot saved as " << oss.str() << "\n";
-                }
-                else if (event.key.code == sf::Keyboard::R)
-                {
-                    resetSimulation(boxes, histogram, balls, stepCount, cycleCount, boxes);
-                    stepCountLabel.setString("Steps: 0");
-                    ballCountLabel.setString("Balls: 1");
-                    cycleCountLabel.setString("Cycles: 0");
-                    cycleWaitTimer.restart();
-                    std::cout << "Simulation reset\n";
-                }
-                else if (event.key.code == sf::Keyboard::F)
-                {
-                    multiplicativeFactor = getUserMultiplicativeFactor();
-                    factorLabel.setString("Factor: " + std::to_string(multiplicativeFactor).substr(0, 4));
-                    resetSimulation(boxes, histogram, balls, stepCount, cycleCount, boxes);
-                }
-                else if (event.key.code == sf::Keyboard::Equal || event.key.code == sf::Keyboard::Add)
-                {
-                    simulationSpeed = std::min(simulationSpeed + 0.5f, maxSpeed);
-                    speedLabel.setString("Speed: " + std::to_string(simulationSpeed).substr(0, 3) + "x");
-                    std::cout << "Speed increased to " << simulationSpeed << "x\n";
-                }
-                else if (event.key.code == sf::Keyboard::Hyphen || event.key.code == sf::Keyboard::Subtract)
-                {
-                    simulationSpeed = std::max(simulationSpeed - 0.5f, minSpeed);
-                    speedLabel.setString("Speed: " + std::to_string(simulationSpeed).substr(0, 3) + "x");
-                    std::cout << "Speed decreased to " << simulationSpeed << "x\n";
-                }
-                else if (event.key.code == sf::Keyboard::Space)
-                {
-                    isPaused = !isPaused;
-                    pauseLabel.setString(isPaused ? "PAUSED" : "");
-                    std::cout << (isPaused ? "Simulation paused\n" : "Simulation resumed\n");
-                }
-            }
+            std::cout << "Could not restore checkpoint " << restorePath << "\n";
+            return -1;
         }
+        boxCount = sim.layout.boxCount;
+        seed = sim.seed;
+        // A prior read from a file is kept as weights, which only fit its own state count
+        sim.fixedStateCount = sim.fixedStateCount || (!sim.process.uniform && sim.priorPower == 0.0);
+        multiplicativeFactor = sim.multiplicativeFactor;
+        std::cout << "Restored cycle " << sim.cycleCount << ", step " << sim.stepCount << " of seed " << seed
+                  << " from " << restorePath << "\n";
+    }
+
+    // Box2D flights, once the state count is known
+    PhysicsWorld physics;
+    if (physicsBodies > 0 && boxCount > PHYSICS_MAX_BOX_COUNT)
+        std::cout << "Physics mode needs at most " << PHYSICS_MAX_BOX_COUNT - 1 << " states, using animated jumps\n";
+    else if (physicsBodies > 0)
+    {
+        initPhysics(physics, sim.layout);
+        sim.physics = &physics;
+        sim.maxAnimatedBalls = physicsBodies;
+    }
+    else if (maxBalls > 0)
+        sim.maxAnimatedBalls = maxBalls; // set after initSimulation, which reserves for the default
 
-        if (!isPaused)
+    EventLogWriter eventLog;
+    if (replayLog.records)
+        startReplay(sim, replayLog);
+    else if (!eventLogPath.empty())
+    {
+        if (!openEventLog(eventLog, eventLogPath, boxCount, seed, multiplicativeFactor))
         {
-            float dt = frameTimer.restart().asSeconds();
-            float adjustedWaitTime = waitTime / simulationSpeed;
-            float adjustedJumpDuration = jumpDurationBase / simulationSpeed;
+            std::cout << "Could not write event log " << eventLogPath << "\n";
+            return -1;
+        }
+        sim.eventLog = &eventLog;
+    }
 
-            // Check if all balls have reached the end
-            bool allBallsAtEnd = true;
-            for (const auto &ball : balls)
+    CycleStatsWriter cycleStats;
+    if (!statsPath.empty())
+    {
+        // A restored run carries on the file its checkpoint was writing
+        if (sim.restoredStatsBytes > 0)
+        {
+            if (!continueCycleStats(cycleStats, statsPath, boxCount, sim.restoredStatsBytes))
             {
-                if (!ball.hasReachedEnd)
-                {
-                    allBallsAtEnd = false;
-                    break;
-                }
+                std::cout << "Statistics " << statsPath << " do not continue the checkpoint " << restorePath << "\n";
+                return -1;
             }
+        }
+        else if (!openCycleStats(cycleStats, statsPath, boxCount, seed, multiplicativeFactor))
+        {
+            std::cout << "Could not write statistics " << statsPath << "\n";
+            return -1;
+        }
+        sim.cycleStats = &cycleStats;
+    }
 
-            // If all balls have reached the end, wait and start new cycle
-            if (allBallsAtEnd && balls.size() > 0)
-            {
-                if (cycleWaitTimer.getElapsedTime().asSeconds() > cycleWaitTime / simulationSpeed)
-                {
-                    startNewCycle(balls, boxes, cycleCount);
-                    cycleCountLabel.setString("Cycles: " + std::to_string(cycleCount));
-                    cycleWaitTimer.restart();
-                }
-            }
-            else
-            {
-                // Process all balls
-                std::vector<Ball> newBalls;
+    CheckpointWriter checkpoint;
+    if (!checkpointPath.empty() && !replayLog.records)
+    {
+        startCheckpointWriter(checkpoint, checkpointPath, checkpointInterval);
+        sim.checkpoint = &checkpoint;
+    }
 
-                for (auto &ball : balls)
-                {
-                    // Update trail first
-                    ball.trail.push_back(ball.position);
-                    if (ball.trail.size() > maxTrailSize)
-                        ball.trail.erase(ball.trail.begin());
+    // Exact law drawn over the histogram, switched with e; a target accuracy turns it on
+    sim.targetKl = targetKl;
+    sim.targetL1 = targetL1;
+    sim.trackConvergence = targetKl > 0.0 || targetL1 > 0.0;
+    refreshConvergence(sim);
+    bool showExact = sim.trackConvergence;
+
+    // Stairs, histogram, labels and balls. Labels drawn after the frame is read
+    // back, and so kept out of recordings, have their own HUD.
+    SimulationView view;
+    if (!createSimulationView(view, glyphAtlas, boxCount, multiplicativeFactor))
+        return -1;
+    Hud statusHud;
+    createHud(statusHud, glyphAtlas);
+    int recordLabel = addHudLabel(statusHud, 13, sf::Color(255, 100, 100), sf::Vector2f(WINDOW_WIDTH - 400, 296), 64);
+    int profileLabel = addHudLabel(statusHud, 11, sf::Color(180, 220, 255), sf::Vector2f(WINDOW_WIDTH - 220, 264), 1024);
+
+    // Parameters are typed into the window, F opens the editor
+    ParameterEditor editor;
+    createParameterEditor(editor, glyphAtlas, sf::Vector2f(WINDOW_WIDTH - 400, 332));
+
+    // Heatmap for large populations, switched with h or past DENSITY_AUTO_BALLS
+    bool heatmapRequested = false;
+    sf::Clock frameClock;
+
+    startFrameCapture(capture);
+    std::string screenshotPath;
+
+    // Phase timings, shown with p and streamed to --profile-csv
+    FrameProfiler profiler;
+    if (!startFrameProfiler(profiler, profileCsvPath))
+        std::cout << "Could not write " << profileCsvPath << "\n";
+    sim.profileSamples = &profiler.simulationSamples;
+    ProfileRing *renderSamples = &profiler.renderSamples;
+
+    sf::Clock profileClock;
+
+    std::thread simThread(runSimulation, std::ref(sim));
+
+    while (window.isOpen())
+    {
+        std::uint64_t frameAllocations = allocationCount.load(std::memory_order_relaxed);
 
-                    if (ball.hasReachedEnd)
+        {
+            ScopedTimer timer(renderSamples, ProfilePhase::Events);
+            sf::Event event;
+            while (window.pollEvent(event))
+            {
+                if (event.type == sf::Event::Closed)
+                    window.close();
+                if (handleEditorEvent(editor, event, sim.snapshots.readBuffer(), sim))
+                    continue;
+                if (event.type == sf::Event::KeyPressed)
+                {
+                    if (event.key.code == sf::Keyboard::S)
                     {
-                        // Ball has reached the end, just keep it there
-                        newBalls.push_back(ball);
-                        continue;
+                        // Taken after this frame is drawn and saved on an encoder thread
+                        auto now = std::time(nullptr);
+                        std::tm *tm_ptr = std::localtime(&now);
+                        std::ostringstream oss;
+                        oss << "screenshot_" << std::put_time(tm_ptr, "%Y%m%d_%H%M%S") << ".png";
+                        screenshotPath = oss.str();
                     }
-
-                    if (!ball.isJumping && ball.timer.getElapsedTime().asSeconds() > adjustedWaitTime)
+                    else if (event.key.code == sf::Keyboard::V)
                     {
-                        if (ball.currentBox > 0)
-                        {
-                            boxes[ball.currentBox].visits++;
-                            boxes[ball.currentBox].countText.setString(std::to_string(boxes[ball.currentBox].visits));
-                            updateHistogram(histogram, boxes);
-                            stepCount++;
-                        }
-
-                        if (ball.currentBox == BOX_COUNT - 1)
-                        {
-                            // Ball reached the end
-                            ball.hasReachedEnd = true;
-                            newBalls.push_back(ball);
-                        }
-                        else
-                        {
-                            // Split the ball based on multiplicative factor
-                            std::vector<Ball> splitBalls = splitBall(ball, multiplicativeFactor, boxes, rng);
-
-                            // Setup jump for each new ball
-                            for (auto &newBall : splitBalls)
-                            {
-                                std::uniform_int_distribution<int> dist(ball.currentBox + 1, BOX_COUNT - 1);
-                                newBall.nextBox = dist(rng);
-                                newBall.startPos = ball.position;
-                                newBall.targetPos.x = boxes[newBall.nextBox].x * SCALE + BOX_WIDTH * SCALE / 2.f;
-                                newBall.targetPos.y = WINDOW_HEIGHT - boxes[newBall.nextBox].height * SCALE - BALL_RADIUS * SCALE;
-                                newBall.isJumping = true;
-                                newBall.jumpProgress = 0.0f;
-                                newBall.timer.restart();
-                            }
-
-                            newBalls.insert(newBalls.end(), splitBalls.begin(), splitBalls.end());
-                        }
+                        toggleRecording(capture, window);
                     }
-                    else if (ball.isJumping)
+                    else if (event.key.code == sf::Keyboard::P)
                     {
-                        ball.jumpProgress += dt / adjustedJumpDuration;
-                        if (ball.jumpProgress >= 1.0f)
-                        {
-                            ball.jumpProgress = 1.0f;
-                            ball.position = ball.targetPos;
-                            ball.currentBox = ball.nextBox;
-                            ball.isJumping = false;
-                            ball.timer.restart();
-                        }
-                        else
-                        {
-                            float t = smoothStep(ball.jumpProgress);
-                            ball.position.x = ball.startPos.x + (ball.targetPos.x - ball.startPos.x) * t;
-                            float baseY = ball.startPos.y + (ball.targetPos.y - ball.startPos.y) * t;
-                            float arcHeight = 100.0f;
-                            float arcOffset = -arcHeight * 4.0f * ball.jumpProgress * (1.0f - ball.jumpProgress);
-                            ball.position.y = baseY + arcOffset;
-                        }
-
-                        newBalls.push_back(ball);
+                        profiler.visible = !profiler.visible;
                     }
-                    else
+                    else if (event.key.code == sf::Keyboard::R)
                     {
-                        newBalls.push_back(ball);
+                        pushCommand(sim, SimulationCommandType::Reset);
+                    }
+                    else if (event.key.code == sf::Keyboard::F)
+                    {
+                        openParameterEditor(editor, EditField::Factor, sim.snapshots.readBuffer());
+                    }
+                    else if (event.key.code == sf::Keyboard::Equal || event.key.code == sf::Keyboard::Add)
+                    {
+                        pushCommand(sim, SimulationCommandType::ChangeSpeed, 0.5f);
+                    }
+                    else if (event.key.code == sf::Keyboard::Hyphen || event.key.code == sf::Keyboard::Subtract)
+                    {
+                        pushCommand(sim, SimulationCommandType::ChangeSpeed, -0.5f);
+                    }
+                    else if (event.key.code == sf::Keyboard::Space)
+                    {
+                        pushCommand(sim, SimulationCommandType::TogglePause);
+                    }
+                    else if (event.key.code == sf::Keyboard::T)
+                    {
+                        pushCommand(sim, SimulationCommandType::ToggleTurbo);
+                    }
+                    else if (event.key.code == sf::Keyboard::H)
+                    {
+                        heatmapRequested = !heatmapRequested;
+                    }
+                    else if (event.key.code == sf::Keyboard::E)
+                    {
+                        showExact = !showExact;
+                        pushCommand(sim, SimulationCommandType::SetConvergence, showExact ? 1.0f : 0.0f);
                     }
-                }
-
-                balls = std::move(newBalls);
-
-                // Update display labels
-                ballCountLabel.setString("Balls: " + std::to_string(balls.size()));
-                stepCountLabel.setString("Steps: " + std::to_string(stepCount));
-
-                // Limit number of balls to prevent performance issues
-                if (balls.size() > 1000)
-                {
-                    balls.erase(balls.begin() + 1000, balls.end());
-                    std::cout << "Limited balls to 1000 for performance\n";
                 }
             }
         }
-        else
+
+        // Pick up the newest simulation state, if any
+        if (sim.snapshots.update())
         {
-            frameTimer.restart(); // Keep timer in sync when paused
+            ScopedTimer timer(renderSamples, ProfilePhase::Snapshot);
+            syncSimulationView(view, sim.snapshots.readBuffer());
         }
 
-        // Rendering
-        window.clear(sf::Color::Black);
-
-        window.draw(histTitle);
-        window.draw(yAxisLabel);
-        window.draw(xAxisLabel);
-
-
-        window.draw(stateCountLabel);
-        window.draw(stepCountLabel);
-        window.draw(ballCountLabel);
-        window.draw(factorLabel);
-        window.draw(cycleCountLabel);
+        // Apply this frame's visits to the histogram in one pass
+        {
+            ScopedTimer timer(renderSamples, ProfilePhase::Histogram);
+            updateSimulationView(view);
+        }
 
-        for (const auto &histBar : histogram)
+        // Rendering
         {
-            window.draw(histBar.bar);
-            window.draw(histBar.label);
-            if (histBar.bar.getSize().y > 10)
-                window.draw(histBar.valueText);
+            ScopedTimer timer(renderSamples, ProfilePhase::Draw);
+            window.clear(sf::Color::Black);
+            profiler.drawCalls += drawSimulationScene(view, window);
         }
 
-        for (const auto &box : boxes)
+        // Draw all balls and their trails in one batch, or their density in one texture
         {
-            window.draw(box.shape);
-            window.draw(box.countText);
+            ScopedTimer timer(renderSamples, ProfilePhase::Balls);
+            drawSimulationBalls(view, sim, window, heatmapRequested, frameClock.restart().asSeconds());
+            profiler.drawCalls++;
         }
 
-        // Draw all balls and their trails
-        for (const auto &ball : balls)
+        // Read back the finished frame before it is presented
         {
-            // Draw trail with fading effect
-            for (size_t i = 0; i < ball.trail.size(); ++i)
+            ScopedTimer timer(renderSamples, ProfilePhase::Capture);
+            if (!screenshotPath.empty())
             {
-                float alpha = static_cast<float>(i) / ball.trail.size() * 120;
-                sf::CircleShape trailDot(BALL_RADIUS * SCALE / 2.5f);
-                trailDot.setOrigin(trailDot.getRadius(), trailDot.getRadius());
-                trailDot.setPosition(ball.trail[i]);
-                sf::Color trailColor = ball.color;
-                trailColor.a = static_cast<sf::Uint8>(alpha);
-                trailDot.setFillColor(trailColor);
-                window.draw(trailDot);
+                captureScreenshot(capture, window, screenshotPath);
+                screenshotPath.clear();
             }
+            recordFrame(capture, window);
+        }
 
-            // Draw ball
-            ballShape.setPosition(ball.position);
-            ballShape.setFillColor(ball.color);
-            window.draw(ballShape);
+        // Drawn after the read back so they stay out of the recording
+        setHudHidden(statusHud, recordLabel, !capture.recording);
+        if (capture.recording)
+        {
+            char buffer[HUD_NUMBER_CHARS];
+            char *last = buffer + sizeof(buffer);
+            char *end = formatCount(appendText(buffer, last, "REC "), last, capture.recordedFrames);
+            end = formatCount(appendText(end, last, " frames, queue "), last, captureQueueDepth(capture));
+            end = formatCount(appendText(end, last, ", dropped "), last, capture.droppedFrames.load());
+            setHudText(statusHud, recordLabel, buffer, end);
+        }
+        setHudHidden(statusHud, profileLabel, !profiler.visible);
+        if (profiler.visible && profileClock.getElapsedTime().asSeconds() > PROFILE_HUD_INTERVAL)
+        {
+            setHudText(statusHud, profileLabel, formatProfileOverlay(profiler));
+            profileClock.restart();
         }
+        updateHud(statusHud);
+        profiler.drawCalls += drawHud(statusHud, window);
+        profiler.drawCalls += drawParameterEditor(editor, window);
+
+        {
+            ScopedTimer timer(renderSamples, ProfilePhase::Display);
+            window.display();
+        }
+        finishProfileFrame(profiler, allocationCount.load(std::memory_order_relaxed) - frameAllocations);
+    }
 
-        window.display();
+    sim.running = false;
+    simThread.join();
+    if (sim.checkpoint)
+    {
+        // Taken before the partial cycle record below, so a restored run streams the same cycle
+        queueCheckpoint(checkpoint, sim);
+        stopCheckpointWriter(checkpoint);
+        std::cout << "Wrote " << checkpoint.written << " checkpoints to " << checkpointPath << "\n";
+    }
+    if (sim.eventLog)
+    {
+        closeEventLog(eventLog);
+        std::cout << "Wrote " << eventLog.written << " events to " << eventLogPath << "\n";
+    }
+    if (sim.cycleStats)
+    {
+        recordCycleStats(sim, CYCLE_STATS_PARTIAL);
+        closeCycleStats(cycleStats);
+        std::cout << "Wrote " << cycleStats.cyclesWritten << " cycles to " << statsPath << "\n";
+    }
+    closeEventLogReader(replayLog);
+    if (profiler.csv.is_open())
+    {
+        if (closeProfileCsv(profiler))
+            std::cout << "Frame profile written to " << profileCsvPath << "\n";
+        else
+            std::cout << "Could not write " << profileCsvPath << "\n";
     }
+    if (capture.recording)
+        toggleRecording(capture, window);
+    stopFrameCapture(capture);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <unistd.h>
+
+template <typename T>
+void putValue(std::vector<char> &out, const T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields are copied as bytes");
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void putVector(std::vector<char> &out, const std::vector<T> &values)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields are copied as bytes");
+    putValue(out, static_cast<std::uint64_t>(values.size()));
+    const char *bytes = reinterpret_cast<const char *>(values.data());
+    out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+// Reads fields back in the order they were put; ok turns false on a short buffer
+struct CheckpointCursor
+{
+    const std::vector<char> &data;
+    size_t offset = 0;
+    bool ok = true;
+
+    template <typename T>
+    void get(T &value)
+    {
+        if (!ok || offset + sizeof(T) > data.size())
+        {
+            ok = false;
+            return;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+    }
+
+    template <typename T>
+    void getVector(std::vector<T> &values)
+    {
+        std::uint64_t count = 0;
+        get(count);
+        if (!ok || count > (data.size() - offset) / sizeof(T))
+        {
+            ok = false;
+            return;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), data.data() + offset, count * sizeof(T));
+        offset += count * sizeof(T);
+    }
+};
+
+void serializeSimulation(const Simulation &sim, std::vector<char> &out)
+{
+    out.clear();
+    const BallStore &balls = sim.balls;
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.boxCount = static_cast<std::uint32_t>(sim.layout.boxCount);
+    header.seed = sim.seed;
+    header.ballCount = balls.size();
+    putValue(out, header);
+
+    putValue(out, sim.multiplicativeFactor);
+    putValue(out, sim.stepCount);
+    putValue(out, sim.cycleCount);
+    putValue(out, sim.nextBallId);
+    putValue(out, sim.simulationSpeed);
+    putValue(out, sim.waitTime);
+    putValue(out, sim.jumpDurationBase);
+    putValue(out, sim.cycleWaitTime);
+    putValue(out, sim.isPaused);
+    putValue(out, sim.turbo);
+    putValue(out, sim.simTime);
+    putValue(out, sim.cycleStartTime);
+    putValue(out, sim.stepIndex);
+    putValue(out, sim.maxAnimatedBalls);
+
+    // The RNG state has no binary accessor; its text form is exact
+    std::ostringstream rngState;
+    rngState << sim.rng;
+    std::string rngText = rngState.str();
+    putVector(out, std::vector<char>(rngText.begin(), rngText.end()));
+
+    putValue(out, sim.process.uniform);
+    putValue(out, sim.process.noise);
+    putVector(out, sim.process.cumulative);
+    putVector(out, sim.process.guide);
+
+    putVector(out, sim.visits);
+
+    putVector(out, balls.position);
+    putVector(out, balls.startX);
+    putVector(out, balls.startY);
+    putVector(out, balls.targetX);
+    putVector(out, balls.targetY);
+    putVector(out, balls.currentBox);
+    putVector(out, balls.nextBox);
+    putVector(out, balls.isJumping);
+    putVector(out, balls.jumpProgress);
+    putVector(out, balls.restStart);
+    putVector(out, balls.color);
+    putVector(out, balls.hasReachedEnd);
+    putVector(out, balls.id);
+    putVector(out, balls.trail);
+    putVector(out, balls.trailHead);
+    putVector(out, balls.trailSize);
+
+    // Aggregates of the cycle in progress, so streamed statistics continue too
+    std::vector<std::uint64_t> cycleVisits;
+    for (int box : sim.cycleBoxes)
+        cycleVisits.push_back(sim.cycleVisits[box]);
+    putVector(out, sim.cycleBoxes);
+    putVector(out, cycleVisits);
+    putValue(out, sim.cycleStartSteps);
+    putValue(out, sim.cyclePeakBalls);
+    putValue(out, sim.cycleCascadeBalls);
+
+    // Editor changes waiting for the cycle boundary, and what a new state count rebuilds the prior from
+    putValue(out, sim.pendingChanges);
+    putValue(out, sim.priorPower);
+    putValue(out, sim.cycleStats ? sim.cycleStats->bytes : std::uint64_t(0));
+}
+
+// Every per-ball array as long as the positions, and every stored index within
+// the array it indexes, so a damaged checkpoint cannot reach out of bounds
+bool restoredIndicesValid(const Simulation &sim, int boxCount)
+{
+    const BallStore &balls = sim.balls;
+    const size_t count = balls.size();
+    const size_t sizes[] = {balls.startX.size(), balls.startY.size(), balls.targetX.size(), balls.targetY.size(),
+                            balls.currentBox.size(), balls.nextBox.size(), balls.isJumping.size(), balls.jumpProgress.size(),
+                            balls.restStart.size(), balls.color.size(), balls.hasReachedEnd.size(), balls.id.size(),
+                            balls.trailHead.size(), balls.trailSize.size()};
+    for (size_t size : sizes)
+    {
+        if (size != count)
+            return false;
+    }
+    auto inBoxes = [boxCount](int box) { return box >= 0 && box < boxCount; };
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!inBoxes(balls.currentBox[i]) || !inBoxes(balls.nextBox[i]) || balls.trailHead[i] < 0 ||
+            balls.trailHead[i] >= MAX_TRAIL_SIZE || balls.trailSize[i] < 0 || balls.trailSize[i] > MAX_TRAIL_SIZE)
+            return false;
+    }
+    if (!std::all_of(sim.cycleBoxes.begin(), sim.cycleBoxes.end(), inBoxes) ||
+        !std::all_of(sim.process.guide.begin(), sim.process.guide.end(), inBoxes))
+        return false;
+    const int pendingBoxes = sim.pendingChanges.boxCount;
+    return pendingBoxes == 0 || (pendingBoxes >= 2 && pendingBoxes <= MAX_BOX_COUNT);
+}
+
+bool restoreSimulation(Simulation &sim, const std::vector<char> &data)
+{
+    CheckpointCursor in{data};
+    CheckpointHeader header;
+    in.get(header);
+    if (!in.ok || std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.boxCount < 2 ||
+        header.boxCount > static_cast<std::uint32_t>(MAX_BOX_COUNT))
+        return false;
+
+    const int boxCount = static_cast<int>(header.boxCount);
+    initSimulation(sim, boxCount, 1.0f, header.seed);
+
+    in.get(sim.multiplicativeFactor);
+    in.get(sim.stepCount);
+    in.get(sim.cycleCount);
+    in.get(sim.nextBallId);
+    in.get(sim.simulationSpeed);
+    in.get(sim.waitTime);
+    in.get(sim.jumpDurationBase);
+    in.get(sim.cycleWaitTime);
+    in.get(sim.isPaused);
+    in.get(sim.turbo);
+    in.get(sim.simTime);
+    in.get(sim.cycleStartTime);
+    in.get(sim.stepIndex);
+    in.get(sim.maxAnimatedBalls);
+
+    std::vector<char> rngText;
+    in.getVector(rngText);
+    std::istringstream rngState(std::string(rngText.begin(), rngText.end()));
+    rngState >> sim.rng;
+    if (!rngState)
+        return false;
+
+    in.get(sim.process.uniform);
+    in.get(sim.process.noise);
+    in.getVector(sim.process.cumulative);
+    in.getVector(sim.process.guide);
+    sim.process.boxCount = boxCount;
+
+    in.getVector(sim.visits);
+
+    BallStore &balls = sim.balls;
+    in.getVector(balls.position);
+    in.getVector(balls.startX);
+    in.getVector(balls.startY);
+    in.getVector(balls.targetX);
+    in.getVector(balls.targetY);
+    in.getVector(balls.currentBox);
+    in.getVector(balls.nextBox);
+    in.getVector(balls.isJumping);
+    in.getVector(balls.jumpProgress);
+    in.getVector(balls.restStart);
+    in.getVector(balls.color);
+    in.getVector(balls.hasReachedEnd);
+    in.getVector(balls.id);
+    in.getVector(balls.trail);
+    in.getVector(balls.trailHead);
+    in.getVector(balls.trailSize);
+    balls.body.assign(balls.size(), nullptr); // jumps in flight start over in physics mode
+
+    std::vector<std::uint64_t> cycleVisits;
+    in.getVector(sim.cycleBoxes);
+    in.getVector(cycleVisits);
+    in.get(sim.cycleStartSteps);
+    in.get(sim.cyclePeakBalls);
+    in.get(sim.cycleCascadeBalls);
+
+    in.get(sim.pendingChanges);
+    in.get(sim.priorPower);
+    in.get(sim.restoredStatsBytes);
+
+    if (!in.ok || sim.visits.size() != header.boxCount || balls.size() != header.ballCount ||
+        balls.trail.size() != balls.size() * MAX_TRAIL_SIZE || cycleVisits.size() != sim.cycleBoxes.size() ||
+        sim.process.cumulative.size() != header.boxCount || !restoredIndicesValid(sim, boxCount))
+        return false;
+
+    for (size_t k = 0; k < sim.cycleBoxes.size(); ++k)
+        sim.cycleVisits[sim.cycleBoxes[k]] = cycleVisits[k];
+    for (int box = 0; box < boxCount; ++box)
+    {
+        int bin = sim.bins.binOfBox[box];
+        if (bin >= 0)
+            sim.bins.binVisits[bin] += sim.visits[box];
+    }
+    return true;
+}
+
+bool loadCheckpoint(Simulation &sim, const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return restoreSimulation(sim, data);
+}
+
+// Writer thread: one file per pending snapshot, replaced atomically
+void runCheckpointWriter(CheckpointWriter &writer)
+{
+    const std::string temporary = writer.path + ".tmp";
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+            writer.wake.wait(lock, [&]() { return writer.stopping || writer.hasPending; });
+            if (!writer.hasPending)
+                return;
+            writer.writing.swap(writer.pending);
+            writer.hasPending = false;
+        }
+
+        std::FILE *file = std::fopen(temporary.c_str(), "wb");
+        if (!file)
+        {
+            std::cout << "Could not write checkpoint " << temporary << "\n";
+            continue;
+        }
+        bool complete = std::fwrite(writer.writing.data(), 1, writer.writing.size(), file) == writer.writing.size();
+        complete = std::fflush(file) == 0 && complete;
+        complete = fsync(fileno(file)) == 0 && complete;
+        std::fclose(file);
+        if (complete && std::rename(temporary.c_str(), writer.path.c_str()) == 0)
+            writer.written++;
+        else
+            std::cout << "Could not write checkpoint " << writer.path << "\n";
+    }
+}
+
+void startCheckpointWriter(CheckpointWriter &writer, const std::string &path, double interval)
+{
+    writer.path = path;
+    writer.interval = interval;
+    writer.lastQueued = std::chrono::steady_clock::now();
+    writer.thread = std::thread(runCheckpointWriter, std::ref(writer));
+}
+
+void queueCheckpoint(CheckpointWriter &writer, const Simulation &sim)
+{
+    // The statistics the checkpoint counts are on disk before it is
+    if (sim.cycleStats)
+        flushCycleStats(*sim.cycleStats);
+    serializeSimulation(sim, writer.filling);
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.filling.swap(writer.pending);
+        writer.hasPending = true;
+    }
+    writer.wake.notify_one();
+    writer.lastQueued = std::chrono::steady_clock::now();
+}
+
+void checkpointIfDue(CheckpointWriter &writer, const Simulation &sim)
+{
+    if (std::chrono::steady_clock::now() - writer.lastQueued >= std::chrono::duration<double>(writer.interval))
+        queueCheckpoint(writer, sim);
+}
+
+void stopCheckpointWriter(CheckpointWriter &writer)
+{
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.stopping = true;
+    }
+    writer.wake.notify_all();
+    if (writer.thread.joinable())
+        writer.thread.join();
+}
@@ -0,0 +1,227 @@
+#include "comparison.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+// Entry i of values, or its last entry past the end, or fallback if it is empty
+double comparisonEntry(const std::vector<double> &values, size_t i, double fallback)
+{
+    if (values.empty())
+        return fallback;
+    return values[std::min(i, values.size() - 1)];
+}
+
+std::vector<ComparisonConfig> makeComparisonConfigs(const std::vector<double> &factors, const std::vector<double> &states,
+                                                    const std::vector<double> &seeds, const ComparisonConfig &base)
+{
+    size_t count = std::max(factors.size(), std::max(states.size(), seeds.size()));
+    std::vector<ComparisonConfig> configs(std::min(count, MAX_COMPARISON_PANELS));
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        configs[i].multiplicativeFactor = static_cast<float>(comparisonEntry(factors, i, base.multiplicativeFactor));
+        double stateCount = std::min(comparisonEntry(states, i, base.boxCount - 1), MAX_BOX_COUNT - 1.0);
+        configs[i].boxCount = std::max(static_cast<int>(stateCount) + 1, 2);
+        configs[i].seed = static_cast<std::uint32_t>(comparisonEntry(seeds, i, base.seed));
+    }
+    return configs;
+}
+
+bool validComparisonLists(const std::vector<double> &factors, const std::vector<double> &states,
+                          const std::vector<double> &seeds)
+{
+    for (double factor : factors)
+    {
+        if (!(factor >= 0.0 && factor <= std::numeric_limits<float>::max()))
+            return false;
+    }
+    for (double stateCount : states)
+    {
+        if (!(stateCount >= 1.0) || stateCount != std::floor(stateCount))
+            return false;
+    }
+    for (double seed : seeds)
+    {
+        if (!(seed >= 0.0 && seed <= std::numeric_limits<std::uint32_t>::max()) || seed != std::floor(seed))
+            return false;
+    }
+    return true;
+}
+
+// Jump rule of a panel, the classic one unless a prior or noise is set
+bool makeComparisonProcess(SsrProcess &process, const ComparisonConfig &config, const ComparisonOptions &options)
+{
+    std::vector<double> prior;
+    if (options.priorPower != 0.0)
+        prior = powerPrior(config.boxCount - 1, options.priorPower);
+    return makeProcess(process, config.boxCount, prior, options.noise);
+}
+
+bool comparisonPriorsValid(const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options)
+{
+    SsrProcess process;
+    for (const ComparisonConfig &config : configs)
+    {
+        if (!makeComparisonProcess(process, config, options))
+            return false;
+    }
+    return true;
+}
+
+bool comparisonTerminates(const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options)
+{
+    SsrProcess process;
+    for (const ComparisonConfig &config : configs)
+    {
+        if (config.multiplicativeFactor < 0.0f || !makeComparisonProcess(process, config, options) ||
+            !cycleTerminates(process, config.multiplicativeFactor))
+            return false;
+    }
+    return true;
+}
+
+// Sets up the run and its view. The render texture holds the whole scene in
+// window coordinates, scaled down to the viewport.
+bool createComparisonPanel(ComparisonPanel &panel, const GlyphAtlas &atlas, const ComparisonConfig &config,
+                           const ComparisonOptions &options, sf::IntRect viewport, unsigned densityThreads)
+{
+    Simulation &sim = panel.sim;
+    initSimulation(sim, config.boxCount, config.multiplicativeFactor, config.seed);
+    if (!makeComparisonProcess(sim.process, config, options))
+        return false;
+    sim.priorPower = options.priorPower;
+    if (options.maxBalls > 0)
+        sim.maxAnimatedBalls = options.maxBalls;
+    sim.trackConvergence = options.showExact;
+    refreshConvergence(sim);
+
+    if (!createSimulationView(panel.view, atlas, config.boxCount, config.multiplicativeFactor, densityThreads))
+        return false;
+    if (!panel.target.create(viewport.width, viewport.height))
+        return false;
+    panel.target.setSmooth(true);
+    panel.target.setView(sf::View(sf::FloatRect(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT)));
+    panel.sprite.setTexture(panel.target.getTexture(), true);
+    panel.sprite.setPosition(static_cast<float>(viewport.left), static_cast<float>(viewport.top));
+    return true;
+}
+
+// Takes in the panel's newest snapshot and redraws it into its render texture
+void drawComparisonPanel(ComparisonPanel &panel, bool heatmapRequested, float frameSeconds)
+{
+    if (panel.sim.snapshots.update())
+        syncSimulationView(panel.view, panel.sim.snapshots.readBuffer());
+    updateSimulationView(panel.view);
+
+    panel.target.clear(sf::Color::Black);
+    drawSimulationScene(panel.view, panel.target);
+    drawSimulationBalls(panel.view, panel.sim, panel.target, heatmapRequested, frameSeconds);
+    panel.target.display();
+}
+
+void pushCommandToAll(std::deque<ComparisonPanel> &panels, SimulationCommandType type, double value = 0.0)
+{
+    for (ComparisonPanel &panel : panels)
+        pushCommand(panel.sim, type, value);
+}
+
+int runComparison(sf::RenderWindow &window, const GlyphAtlas &atlas, FrameCapture &capture,
+                  const std::vector<ComparisonConfig> &configs, const ComparisonOptions &options)
+{
+    // Grid of equal viewports with the window's aspect, centered
+    const int count = static_cast<int>(configs.size());
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const int rows = (count + columns - 1) / columns;
+    const int cells = std::max(columns, rows);
+    const int width = WINDOW_WIDTH / cells;
+    const int height = WINDOW_HEIGHT / cells;
+    const int left = (WINDOW_WIDTH - columns * width) / 2;
+    const int top = (WINDOW_HEIGHT - rows * height) / 2;
+
+    // Heatmaps scatter on the render thread in turn, so they split the cores between them
+    const unsigned densityThreads = std::max(1u, resolveThreadCount(0) / static_cast<unsigned>(count));
+
+    std::deque<ComparisonPanel> panels(configs.size());
+    for (int i = 0; i < count; ++i)
+    {
+        sf::IntRect viewport(left + i % columns * width, top + i / columns * height, width, height);
+        if (!createComparisonPanel(panels[i], atlas, configs[i], options, viewport, densityThreads))
+            return -1;
+        std::cout << "Panel " << i + 1 << ": factor " << configs[i].multiplicativeFactor << ", " << configs[i].boxCount - 1
+                  << " states, seed " << configs[i].seed << "\n";
+    }
+    for (ComparisonPanel &panel : panels)
+        panel.thread = std::thread(runSimulation, std::ref(panel.sim));
+
+    bool heatmapRequested = false;
+    bool showExact = options.showExact;
+    std::string screenshotPath;
+    sf::Clock frameClock;
+    startFrameCapture(capture);
+
+    while (window.isOpen())
+    {
+        sf::Event event;
+        while (window.pollEvent(event))
+        {
+            if (event.type == sf::Event::Closed)
+                window.close();
+            if (event.type != sf::Event::KeyPressed)
+                continue;
+
+            if (event.key.code == sf::Keyboard::S)
+            {
+                auto now = std::time(nullptr);
+                std::ostringstream oss;
+                oss << "screenshot_" << std::put_time(std::localtime(&now), "%Y%m%d_%H%M%S") << ".png";
+                screenshotPath = oss.str();
+            }
+            else if (event.key.code == sf::Keyboard::V)
+                toggleRecording(capture, window);
+            else if (event.key.code == sf::Keyboard::R)
+                pushCommandToAll(panels, SimulationCommandType::Reset);
+            else if (event.key.code == sf::Keyboard::Equal || event.key.code == sf::Keyboard::Add)
+                pushCommandToAll(panels, SimulationCommandType::ChangeSpeed, 0.5f);
+            else if (event.key.code == sf::Keyboard::Hyphen || event.key.code == sf::Keyboard::Subtract)
+                pushCommandToAll(panels, SimulationCommandType::ChangeSpeed, -0.5f);
+            else if (event.key.code == sf::Keyboard::Space)
+                pushCommandToAll(panels, SimulationCommandType::TogglePause);
+            else if (event.key.code == sf::Keyboard::T)
+                pushCommandToAll(panels, SimulationCommandType::ToggleTurbo);
+            else if (event.key.code == sf::Keyboard::H)
+                heatmapRequested = !heatmapRequested;
+            else if (event.key.code == sf::Keyboard::E)
+            {
+                showExact = !showExact;
+                pushCommandToAll(panels, SimulationCommandType::SetConvergence, showExact ? 1.0f : 0.0f);
+            }
+        }
+
+        float frameSeconds = frameClock.restart().asSeconds();
+        for (ComparisonPanel &panel : panels)
+            drawComparisonPanel(panel, heatmapRequested, frameSeconds);
+
+        window.clear(sf::Color(30, 30, 30));
+        for (const ComparisonPanel &panel : panels)
+            window.draw(panel.sprite);
+
+        if (!screenshotPath.empty())
+        {
+            captureScreenshot(capture, window, screenshotPath);
+            screenshotPath.clear();
+        }
+        recordFrame(capture, window);
+        window.display();
+    }
+
+    for (ComparisonPanel &panel : panels)
+        panel.sim.running = false;
+    for (ComparisonPanel &panel : panels)
+        panel.thread.join();
+    if (capture.recording)
+        toggleRecording(capture, window);
+    stopFrameCapture(capture);
+    return 0;
+}
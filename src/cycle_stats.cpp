@@ -0,0 +1,219 @@
+#include "cycle_stats.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool openCycleStats(CycleStatsWriter &writer, const std::string &path, int boxCount, std::uint32_t seed, float multiplicativeFactor)
+{
+    writer.file = std::fopen(path.c_str(), "wb");
+    if (!writer.file)
+        return false;
+
+    CycleStatsHeader header{};
+    std::memcpy(header.magic, CYCLE_STATS_MAGIC, sizeof(header.magic));
+    header.boxCount = static_cast<std::uint32_t>(boxCount);
+    header.seed = seed;
+    header.multiplicativeFactor = multiplicativeFactor;
+    std::fwrite(&header, sizeof(header), 1, writer.file);
+
+    writer.buffer.resize(CYCLE_STATS_BUFFER_BYTES);
+    writer.used = 0;
+    writer.cyclesWritten = 0;
+    writer.bytes = sizeof(header);
+    writer.lastFlush = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool continueCycleStats(CycleStatsWriter &writer, const std::string &path, int boxCount, std::uint64_t bytes)
+{
+    CycleStatsReader reader;
+    if (!openCycleStatsReader(reader, path))
+        return false;
+    bool matches = reader.header->boxCount == static_cast<std::uint32_t>(boxCount) && bytes >= sizeof(CycleStatsHeader) &&
+                   bytes <= reader.size;
+    size_t offset = 0;
+    const CycleStatsRecord *record;
+    const CycleVisit *visits;
+    while (matches && sizeof(CycleStatsHeader) + offset < bytes)
+        matches = nextCycleStats(reader, offset, record, visits);
+    matches = matches && sizeof(CycleStatsHeader) + offset == bytes;
+    closeCycleStatsReader(reader);
+    if (!matches || truncate(path.c_str(), static_cast<off_t>(bytes)) != 0)
+        return false;
+
+    writer.file = std::fopen(path.c_str(), "ab");
+    if (!writer.file)
+        return false;
+    writer.buffer.resize(CYCLE_STATS_BUFFER_BYTES);
+    writer.used = 0;
+    writer.cyclesWritten = 0;
+    writer.bytes = bytes;
+    writer.lastFlush = std::chrono::steady_clock::now();
+    return true;
+}
+
+void flushCycleStats(CycleStatsWriter &writer)
+{
+    if (!writer.file)
+        return;
+    if (writer.used > 0)
+    {
+        std::fwrite(writer.buffer.data(), 1, writer.used, writer.file);
+        writer.used = 0;
+    }
+    std::fflush(writer.file);
+    writer.lastFlush = std::chrono::steady_clock::now();
+}
+
+// Copies bytes into the buffer, writing it out whenever it fills
+void appendCycleStats(CycleStatsWriter &writer, const void *data, size_t bytes)
+{
+    const char *source = static_cast<const char *>(data);
+    writer.bytes += bytes;
+    while (bytes > 0)
+    {
+        size_t chunk = std::min(bytes, writer.buffer.size() - writer.used);
+        std::memcpy(writer.buffer.data() + writer.used, source, chunk);
+        writer.used += chunk;
+        source += chunk;
+        bytes -= chunk;
+        if (writer.used == writer.buffer.size())
+        {
+            std::fwrite(writer.buffer.data(), 1, writer.used, writer.file);
+            writer.used = 0;
+        }
+    }
+}
+
+void writeCycleStats(CycleStatsWriter &writer, CycleStatsRecord record, const std::vector<int> &boxes,
+                     const std::vector<std::uint64_t> &visits)
+{
+    if (!writer.file)
+        return;
+    record.visitedBoxes = static_cast<std::uint32_t>(boxes.size());
+    appendCycleStats(writer, &record, sizeof(record));
+    for (size_t k = 0; k < boxes.size(); ++k)
+    {
+        CycleVisit entry{static_cast<std::uint32_t>(boxes[k]), 0, visits[boxes[k]]};
+        appendCycleStats(writer, &entry, sizeof(entry));
+    }
+    writer.cyclesWritten++;
+
+    if (std::chrono::steady_clock::now() - writer.lastFlush > std::chrono::duration<double>(CYCLE_STATS_FLUSH_SECONDS))
+        flushCycleStats(writer);
+}
+
+void closeCycleStats(CycleStatsWriter &writer)
+{
+    flushCycleStats(writer);
+    if (writer.file)
+        std::fclose(writer.file);
+    writer.file = nullptr;
+}
+
+void closeCycleStatsReader(CycleStatsReader &reader)
+{
+    if (reader.data)
+        munmap(reader.data, reader.size);
+    if (reader.fd >= 0)
+        close(reader.fd);
+    reader = CycleStatsReader();
+}
+
+// Box count within CYCLE_STATS_MAX_BOX_COUNT, and every box of every record below it
+bool cycleStatsIndicesValid(const CycleStatsReader &reader)
+{
+    const std::uint32_t boxCount = reader.header->boxCount;
+    if (boxCount < 2 || boxCount > CYCLE_STATS_MAX_BOX_COUNT)
+        return false;
+    size_t offset = 0;
+    const CycleStatsRecord *record;
+    const CycleVisit *visits;
+    while (nextCycleStats(reader, offset, record, visits))
+    {
+        for (std::uint32_t k = 0; k < record->visitedBoxes; ++k)
+        {
+            if (visits[k].box >= boxCount)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool openCycleStatsReader(CycleStatsReader &reader, const std::string &path)
+{
+    reader.fd = open(path.c_str(), O_RDONLY);
+    if (reader.fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(reader.fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CycleStatsHeader))
+    {
+        closeCycleStatsReader(reader);
+        return false;
+    }
+    reader.size = static_cast<size_t>(info.st_size);
+    reader.data = mmap(nullptr, reader.size, PROT_READ, MAP_PRIVATE, reader.fd, 0);
+    if (reader.data == MAP_FAILED)
+    {
+        reader.data = nullptr;
+        closeCycleStatsReader(reader);
+        return false;
+    }
+    madvise(reader.data, reader.size, MADV_SEQUENTIAL);
+
+    reader.header = static_cast<const CycleStatsHeader *>(reader.data);
+    if (std::memcmp(reader.header->magic, CYCLE_STATS_MAGIC, sizeof(CYCLE_STATS_MAGIC)) != 0 || !cycleStatsIndicesValid(reader))
+    {
+        closeCycleStatsReader(reader);
+        return false;
+    }
+    return true;
+}
+
+bool nextCycleStats(const CycleStatsReader &reader, size_t &offset, const CycleStatsRecord *&record,
+                    const CycleVisit *&visits)
+{
+    const char *base = static_cast<const char *>(reader.data) + sizeof(CycleStatsHeader);
+    const size_t available = reader.size - sizeof(CycleStatsHeader);
+    if (offset + sizeof(CycleStatsRecord) > available)
+        return false;
+
+    const CycleStatsRecord *candidate = reinterpret_cast<const CycleStatsRecord *>(base + offset);
+    size_t bytes = sizeof(CycleStatsRecord) + static_cast<size_t>(candidate->visitedBoxes) * sizeof(CycleVisit);
+    if (offset + bytes > available)
+        return false;
+
+    record = candidate;
+    visits = reinterpret_cast<const CycleVisit *>(base + offset + sizeof(CycleStatsRecord));
+    offset += bytes;
+    return true;
+}
+
+EngineResult summarizeCycleStats(const CycleStatsReader &reader)
+{
+    EngineResult result;
+    result.visits.assign(reader.header->boxCount, 0);
+
+    size_t offset = 0;
+    const CycleStatsRecord *record;
+    const CycleVisit *visits;
+    while (nextCycleStats(reader, offset, record, visits))
+    {
+        if (record->flags & CYCLE_STATS_RESET)
+        {
+            std::fill(result.visits.begin(), result.visits.end(), 0);
+            result.steps = 0;
+            result.cycles = 0;
+            continue;
+        }
+        if (record->flags & CYCLE_STATS_PARTIAL)
+            continue;
+        for (std::uint32_t k = 0; k < record->visitedBoxes; ++k)
+            result.visits[visits[k].box] += visits[k].visits;
+        result.steps += record->steps;
+        result.cycles++;
+    }
+    return result;
+}
@@ -0,0 +1,198 @@
+#include "density_renderer.hpp"
+#include "ssr_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// Faint blue through red to yellow, so sparse cells stay see-through
+sf::Color densityColor(float t)
+{
+    auto channel = [](float value) { return static_cast<sf::Uint8>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f); };
+    return sf::Color(channel(2.0f * t), channel(2.0f * t - 1.0f), channel(1.0f - std::abs(2.0f * t - 0.6f)), channel(0.25f + t));
+}
+
+bool createDensityRenderer(DensityRenderer &renderer, unsigned threads)
+{
+    initDensityGrid(renderer, threads);
+    if (!renderer.texture.create(renderer.width, renderer.height))
+        return false;
+    renderer.texture.setSmooth(true);
+    renderer.sprite.setTexture(renderer.texture, true);
+    renderer.sprite.setScale(static_cast<float>(DENSITY_CELL_PIXELS), static_cast<float>(DENSITY_CELL_PIXELS));
+    return true;
+}
+
+void clearDensity(DensityRenderer &renderer)
+{
+    std::fill(renderer.density.begin(), renderer.density.end(), 0.0f);
+    renderer.peak = 1.0f;
+}
+
+// Counts balls first .. last - 1 into tile
+void scatterBalls(const DensityRenderer &renderer, const RenderSnapshot &snapshot, size_t first, size_t last,
+                  std::vector<std::uint32_t> &tile)
+{
+    const float inverseCell = 1.0f / DENSITY_CELL_PIXELS;
+    for (size_t b = first; b < last; ++b)
+    {
+        int x = static_cast<int>(snapshot.position[b].x * inverseCell);
+        int y = static_cast<int>(snapshot.position[b].y * inverseCell);
+        if (x >= 0 && x < renderer.width && y >= 0 && y < renderer.height)
+            tile[static_cast<size_t>(y) * renderer.width + x]++;
+    }
+}
+
+// Merges rows first .. last - 1 of the used tiles into the decayed density and
+// colors them. Returns the densest cell of those rows.
+float mergeRows(DensityRenderer &renderer, size_t tilesUsed, float decay, int firstRow, int lastRow)
+{
+    const float scale = 255.0f / std::log1p(renderer.peak);
+    float peak = 0.0f;
+    for (size_t cell = static_cast<size_t>(firstRow) * renderer.width; cell < static_cast<size_t>(lastRow) * renderer.width; ++cell)
+    {
+        std::uint32_t count = 0;
+        for (size_t t = 0; t < tilesUsed; ++t)
+        {
+            count += renderer.tiles[t][cell];
+            renderer.tiles[t][cell] = 0;
+        }
+        // Faded cells drop to exactly 0, which skips the log and keeps denormals out
+        float value = renderer.density[cell] * decay + count;
+        if (value < DENSITY_FLOOR)
+            value = 0.0f;
+        renderer.density[cell] = value;
+        peak = std::max(peak, value);
+
+        int level = value > 0.0f ? std::min(static_cast<int>(std::log1p(value) * scale), 255) : 0;
+        const sf::Color &color = renderer.palette[level];
+        sf::Uint8 *pixel = &renderer.pixels[cell * 4];
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+        pixel[3] = color.a;
+    }
+    return peak;
+}
+
+// Worker's share of the frame in renderer.workers: its slice of balls, then,
+// once every slice is counted, its band of rows
+void densityFrameShare(DensityRenderer &renderer, unsigned worker)
+{
+    DensityWorkers &workers = renderer.workers;
+    const size_t balls = workers.snapshot->ballCount();
+    if (worker < workers.tilesUsed)
+        scatterBalls(renderer, *workers.snapshot, balls * worker / workers.tilesUsed,
+                     balls * (worker + 1) / workers.tilesUsed, renderer.tiles[worker]);
+    {
+        std::unique_lock<std::mutex> lock(workers.mutex);
+        if (++workers.scattered == renderer.threads)
+            workers.wake.notify_all();
+        else
+            workers.wake.wait(lock, [&]() { return workers.scattered == renderer.threads; });
+    }
+
+    int firstRow = renderer.height * worker / renderer.threads;
+    int lastRow = renderer.height * (worker + 1) / renderer.threads;
+    renderer.bandPeaks[worker] = mergeRows(renderer, workers.tilesUsed, workers.decay, firstRow, lastRow);
+    {
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        ++workers.merged;
+    }
+    workers.wake.notify_all();
+}
+
+// Helper thread: one share of every frame after seen until the renderer goes away
+void runDensityWorker(DensityRenderer &renderer, unsigned worker, std::uint64_t seen)
+{
+    DensityWorkers &workers = renderer.workers;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(workers.mutex);
+            workers.wake.wait(lock, [&]() { return workers.stopping || workers.frame != seen; });
+            if (workers.stopping)
+                return;
+            seen = workers.frame;
+        }
+        densityFrameShare(renderer, worker);
+    }
+}
+
+void stopDensityWorkers(DensityWorkers &workers)
+{
+    {
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        workers.stopping = true;
+    }
+    workers.wake.notify_all();
+    for (std::thread &thread : workers.threads)
+        thread.join();
+    workers.threads.clear();
+    workers.stopping = false;
+}
+
+DensityWorkers::~DensityWorkers()
+{
+    stopDensityWorkers(*this);
+}
+
+void initDensityGrid(DensityRenderer &renderer, unsigned threads)
+{
+    renderer.width = WINDOW_WIDTH / DENSITY_CELL_PIXELS;
+    renderer.height = WINDOW_HEIGHT / DENSITY_CELL_PIXELS;
+    renderer.threads = resolveThreadCount(threads);
+    const size_t cells = static_cast<size_t>(renderer.width) * renderer.height;
+    renderer.density.assign(cells, 0.0f);
+    renderer.tiles.assign(renderer.threads, std::vector<std::uint32_t>(cells, 0));
+    renderer.pixels.assign(cells * 4, 0);
+    renderer.bandPeaks.assign(renderer.threads, 0.0f);
+
+    renderer.palette[0] = sf::Color::Transparent;
+    for (int i = 1; i < 256; ++i)
+        renderer.palette[i] = densityColor(i / 255.0f);
+
+    stopDensityWorkers(renderer.workers);
+    for (unsigned worker = 1; worker < renderer.threads; ++worker)
+        renderer.workers.threads.emplace_back(runDensityWorker, std::ref(renderer), worker, renderer.workers.frame);
+}
+
+void accumulateDensity(DensityRenderer &renderer, const RenderSnapshot &snapshot, float dt)
+{
+    const size_t balls = snapshot.ballCount();
+    const size_t tilesUsed = std::max<size_t>(1, std::min<size_t>(renderer.threads, (balls + DENSITY_BALLS_PER_TASK - 1) / DENSITY_BALLS_PER_TASK));
+    const float decay = std::exp(-dt / DENSITY_DECAY_SECONDS);
+
+    // Small populations and single-core hosts stay on the render thread
+    if (tilesUsed == 1)
+    {
+        scatterBalls(renderer, snapshot, 0, balls, renderer.tiles[0]);
+        renderer.peak = std::max(1.0f, mergeRows(renderer, 1, decay, 0, renderer.height));
+        return;
+    }
+
+    // Every worker takes a slice and a band, the render thread included
+    DensityWorkers &workers = renderer.workers;
+    {
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        workers.snapshot = &snapshot;
+        workers.tilesUsed = tilesUsed;
+        workers.decay = decay;
+        workers.scattered = 0;
+        workers.merged = 0;
+        ++workers.frame;
+    }
+    workers.wake.notify_all();
+    densityFrameShare(renderer, 0);
+    {
+        std::unique_lock<std::mutex> lock(workers.mutex);
+        workers.wake.wait(lock, [&]() { return workers.merged == renderer.threads; });
+    }
+
+    renderer.peak = std::max(1.0f, *std::max_element(renderer.bandPeaks.begin(), renderer.bandPeaks.end()));
+}
+
+void drawDensity(DensityRenderer &renderer, sf::RenderTarget &target)
+{
+    renderer.texture.update(renderer.pixels.data());
+    target.draw(renderer.sprite);
+}
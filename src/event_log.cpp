@@ -0,0 +1,185 @@
+#include "event_log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+TransitionRecord makeTransitionRecord(std::uint32_t cycle, std::uint32_t ball, int fromBox, int toBox, int splitCount, bool first)
+{
+    std::uint32_t packed = (static_cast<std::uint32_t>(toBox) & EVENT_TO_MASK) |
+                           ((static_cast<std::uint32_t>(splitCount) & EVENT_SPLIT_MASK) << EVENT_SPLIT_SHIFT) |
+                           (first ? EVENT_FIRST_FLAG : 0u);
+    return TransitionRecord{cycle, ball, static_cast<std::uint32_t>(fromBox), packed};
+}
+
+bool openEventLog(EventLogWriter &writer, const std::string &path, int boxCount, std::uint32_t seed, float multiplicativeFactor)
+{
+    writer.file = std::fopen(path.c_str(), "wb");
+    if (!writer.file)
+        return false;
+
+    EventLogHeader header{};
+    std::memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.boxCount = static_cast<std::uint32_t>(boxCount);
+    header.seed = seed;
+    header.multiplicativeFactor = multiplicativeFactor;
+    std::fwrite(&header, sizeof(header), 1, writer.file);
+
+    writer.buffer.resize(EVENT_LOG_BUFFER_RECORDS);
+    writer.used = 0;
+    writer.written = 0;
+    return true;
+}
+
+void flushEventLog(EventLogWriter &writer)
+{
+    if (writer.file && writer.used > 0)
+    {
+        std::fwrite(writer.buffer.data(), sizeof(TransitionRecord), writer.used, writer.file);
+        writer.used = 0;
+    }
+}
+
+void logEvent(EventLogWriter &writer, const TransitionRecord &record)
+{
+    writer.buffer[writer.used++] = record;
+    writer.written++;
+    if (writer.used == writer.buffer.size())
+        flushEventLog(writer);
+}
+
+void logBulkVisits(EventLogWriter &writer, std::uint32_t cycle, int box, std::uint64_t count)
+{
+    while (count > 0)
+    {
+        std::uint32_t chunk = static_cast<std::uint32_t>(std::min<std::uint64_t>(count, 0xFFFFFFFFu));
+        logEvent(writer, TransitionRecord{cycle, BULK_VISITS_BALL, static_cast<std::uint32_t>(box), chunk});
+        count -= chunk;
+    }
+}
+
+void logReset(EventLogWriter &writer, std::uint32_t cycle, float multiplicativeFactor)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &multiplicativeFactor, sizeof(bits));
+    logEvent(writer, TransitionRecord{cycle, RESET_BALL, 0, bits});
+}
+
+void closeEventLog(EventLogWriter &writer)
+{
+    flushEventLog(writer);
+    if (writer.file)
+        std::fclose(writer.file);
+    writer.file = nullptr;
+}
+
+float resetFactor(const TransitionRecord &record)
+{
+    float factor;
+    std::memcpy(&factor, &record.toBox, sizeof(factor));
+    return factor;
+}
+
+void closeEventLogReader(EventLogReader &reader)
+{
+    if (reader.data)
+        munmap(reader.data, reader.size);
+    if (reader.fd >= 0)
+        close(reader.fd);
+    reader = EventLogReader();
+}
+
+// Box count within what a record can address, and every box of every record below it
+bool eventLogIndicesValid(const EventLogReader &reader)
+{
+    const std::uint32_t boxCount = reader.header->boxCount;
+    if (boxCount < 2 || boxCount > EVENT_TO_MASK + 1)
+        return false;
+    for (size_t i = 0; i < reader.count; ++i)
+    {
+        const TransitionRecord &record = reader.records[i];
+        if (record.ball == RESET_BALL)
+            continue;
+        if (record.fromBox >= boxCount)
+            return false;
+        if (record.ball != BULK_VISITS_BALL && static_cast<std::uint32_t>(record.destination()) >= boxCount)
+            return false;
+    }
+    return true;
+}
+
+bool openEventLogReader(EventLogReader &reader, const std::string &path)
+{
+    reader.fd = open(path.c_str(), O_RDONLY);
+    if (reader.fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(reader.fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(EventLogHeader))
+    {
+        closeEventLogReader(reader);
+        return false;
+    }
+    reader.size = static_cast<size_t>(info.st_size);
+    reader.data = mmap(nullptr, reader.size, PROT_READ, MAP_PRIVATE, reader.fd, 0);
+    if (reader.data == MAP_FAILED)
+    {
+        reader.data = nullptr;
+        closeEventLogReader(reader);
+        return false;
+    }
+    madvise(reader.data, reader.size, MADV_SEQUENTIAL);
+
+    reader.header = static_cast<const EventLogHeader *>(reader.data);
+    if (std::memcmp(reader.header->magic, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC)) != 0)
+    {
+        closeEventLogReader(reader);
+        return false;
+    }
+    reader.records = reinterpret_cast<const TransitionRecord *>(static_cast<const char *>(reader.data) + sizeof(EventLogHeader));
+    reader.count = (reader.size - sizeof(EventLogHeader)) / sizeof(TransitionRecord);
+    if (!eventLogIndicesValid(reader))
+    {
+        closeEventLogReader(reader);
+        return false;
+    }
+    return true;
+}
+
+EngineResult replayEventLogStatistics(const EventLogReader &reader)
+{
+    EngineResult result;
+    result.visits.assign(reader.header->boxCount, 0);
+
+    bool anyCycle = false;
+    std::uint32_t lastCycle = 0;
+    for (size_t i = 0; i < reader.count; ++i)
+    {
+        const TransitionRecord &record = reader.records[i];
+        if (record.ball == RESET_BALL)
+        {
+            std::fill(result.visits.begin(), result.visits.end(), 0);
+            result.steps = 0;
+            result.cycles = 0;
+            anyCycle = false;
+            continue;
+        }
+        if (!anyCycle || record.cycle != lastCycle)
+        {
+            result.cycles++;
+            lastCycle = record.cycle;
+            anyCycle = true;
+        }
+        if (record.ball == BULK_VISITS_BALL)
+        {
+            result.visits[record.fromBox] += record.toBox;
+            result.steps += record.toBox;
+        }
+        else if (record.isFirst() && record.fromBox > 0)
+        {
+            result.visits[record.fromBox]++;
+            result.steps++;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,108 @@
+#include "exact_distribution.hpp"
+#include <algorithm>
+
+double sweepArrivals(const SsrProcess &process, float multiplicativeFactor, double startBalls, double startFlying,
+                     std::vector<double> &arrivals)
+{
+    const int last = process.boxCount - 1;
+    arrivals.assign(process.boxCount, 0.0);
+    double inFlight = startFlying + startBalls * multiplicativeFactor * (1.0 - process.noise);
+    double restarts = startBalls * multiplicativeFactor * process.noise;
+    for (int box = 1; box <= last; ++box)
+    {
+        double landed = inFlight * landingHazard(process, box);
+        arrivals[box] = landed;
+        inFlight -= landed;
+        if (box == last)
+            break;
+        double offspring = landed * multiplicativeFactor;
+        restarts += offspring * process.noise;
+        inFlight += offspring * (1.0 - process.noise);
+    }
+    return restarts;
+}
+
+bool exactVisits(const SsrProcess &process, float multiplicativeFactor, std::vector<double> &expected)
+{
+    double restarts = sweepArrivals(process, multiplicativeFactor, 1.0, 0.0, expected);
+    if (restarts <= 0.0)
+        return true;
+
+    // Each restart brings restartsPerRestart more, so the total is a geometric series
+    std::vector<double> perRestart;
+    double restartsPerRestart = sweepArrivals(process, multiplicativeFactor, 0.0, 1.0, perRestart);
+    if (restartsPerRestart >= 1.0)
+        return false;
+    double totalRestarts = restarts / (1.0 - restartsPerRestart);
+    for (size_t box = 0; box < expected.size(); ++box)
+        expected[box] += totalRestarts * perRestart[box];
+    return true;
+}
+
+bool resetConvergence(ConvergenceTracker &tracker, const SsrProcess &process, float multiplicativeFactor,
+                      const std::vector<int> &binOfBox, int bins, const std::vector<std::uint64_t> &visits)
+{
+    tracker.valid = false;
+    std::vector<double> expected;
+    if (!exactVisits(process, multiplicativeFactor, expected))
+        return false;
+
+    double total = 0.0;
+    for (size_t box = 0; box < expected.size(); ++box)
+        total += binOfBox[box] >= 0 ? expected[box] : 0.0;
+    if (total <= 0.0)
+        return false;
+
+    tracker.logShare.assign(expected.size(), 0.0);
+    tracker.binShare.assign(bins, 0.0);
+    for (size_t box = 0; box < expected.size(); ++box)
+    {
+        if (binOfBox[box] < 0 || expected[box] <= 0.0)
+            continue;
+        double share = expected[box] / total;
+        tracker.logShare[box] = std::log(share);
+        tracker.binShare[binOfBox[box]] += share;
+    }
+    tracker.valid = true;
+    resyncConvergence(tracker, visits);
+    return true;
+}
+
+void resyncConvergence(ConvergenceTracker &tracker, const std::vector<std::uint64_t> &visits)
+{
+    tracker.visits = 0.0;
+    tracker.visitsLogVisits = 0.0;
+    tracker.visitsLogShare = 0.0;
+    for (size_t box = 0; box < visits.size(); ++box)
+    {
+        if (visits[box] == 0)
+            continue;
+        double count = static_cast<double>(visits[box]);
+        tracker.visits += count;
+        tracker.visitsLogVisits += xLogX(count);
+        tracker.visitsLogShare += count * tracker.logShare[box];
+    }
+    tracker.updates = 0;
+}
+
+double klDivergence(const ConvergenceTracker &tracker)
+{
+    if (tracker.visits <= 0.0)
+        return 0.0;
+    double divergence = (tracker.visitsLogVisits - tracker.visitsLogShare) / tracker.visits - std::log(tracker.visits);
+    return std::max(divergence, 0.0); // rounding can take an exact match just below 0
+}
+
+double l1Distance(const ConvergenceTracker &tracker, const std::vector<std::uint64_t> &binVisits)
+{
+    double total = 0.0;
+    for (std::uint64_t count : binVisits)
+        total += static_cast<double>(count);
+    if (total <= 0.0)
+        return 0.0;
+
+    double distance = 0.0;
+    for (size_t bin = 0; bin < binVisits.size() && bin < tracker.binShare.size(); ++bin)
+        distance += std::abs(binVisits[bin] / total - tracker.binShare[bin]);
+    return distance;
+}
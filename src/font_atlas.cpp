@@ -0,0 +1,60 @@
+#include "font_atlas.hpp"
+
+void initGlyphAtlas(GlyphAtlas &atlas)
+{
+    atlas.sizes.assign(BAKED_SIZE_COUNT, AtlasSize());
+    for (size_t s = 0; s < BAKED_SIZE_COUNT; ++s)
+    {
+        atlas.sizes[s].characterSize = BAKED_SIZES[s].characterSize;
+        atlas.sizes[s].lineSpacing = BAKED_SIZES[s].lineSpacing;
+        atlas.sizes[s].glyphs.assign(ATLAS_CHARACTER_COUNT, sf::Glyph());
+        atlas.sizes[s].kerning.assign(ATLAS_CHARACTER_COUNT * ATLAS_CHARACTER_COUNT, 0.0f);
+    }
+
+    for (size_t g = 0; g < BAKED_GLYPH_COUNT; ++g)
+    {
+        const BakedGlyph &baked = BAKED_GLYPHS[g];
+        int size = atlasSizeIndex(atlas, baked.characterSize);
+        if (size < 0 || baked.character < ATLAS_FIRST_CHARACTER || baked.character > ATLAS_LAST_CHARACTER)
+            continue;
+        sf::Glyph &glyph = atlas.sizes[size].glyphs[baked.character - ATLAS_FIRST_CHARACTER];
+        glyph.advance = baked.advance;
+        glyph.bounds = sf::FloatRect(baked.left, baked.top, baked.width, baked.height);
+        glyph.textureRect = sf::IntRect(baked.x, baked.y, baked.pixelWidth, baked.pixelHeight);
+    }
+
+    for (size_t k = 0; k < BAKED_KERNING_COUNT; ++k)
+    {
+        const BakedKerning &pair = BAKED_KERNING[k];
+        int size = atlasSizeIndex(atlas, pair.characterSize);
+        if (size < 0 || pair.first < ATLAS_FIRST_CHARACTER || pair.first > ATLAS_LAST_CHARACTER ||
+            pair.second < ATLAS_FIRST_CHARACTER || pair.second > ATLAS_LAST_CHARACTER)
+            continue;
+        atlas.sizes[size].kerning[(pair.first - ATLAS_FIRST_CHARACTER) * ATLAS_CHARACTER_COUNT + pair.second - ATLAS_FIRST_CHARACTER] = pair.offset;
+    }
+}
+
+bool createGlyphAtlas(GlyphAtlas &atlas)
+{
+    initGlyphAtlas(atlas);
+
+    std::vector<sf::Uint8> pixels(static_cast<size_t>(BAKED_ATLAS_WIDTH) * BAKED_ATLAS_HEIGHT * 4, 255);
+    for (size_t p = 0; p < static_cast<size_t>(BAKED_ATLAS_WIDTH) * BAKED_ATLAS_HEIGHT; ++p)
+        pixels[p * 4 + 3] = BAKED_ATLAS[p];
+    if (!atlas.texture.create(BAKED_ATLAS_WIDTH, BAKED_ATLAS_HEIGHT))
+        return false;
+    atlas.texture.update(pixels.data());
+    // sf::Font textures are smooth too, so the rotated axis label looks the same
+    atlas.texture.setSmooth(true);
+    return true;
+}
+
+int atlasSizeIndex(const GlyphAtlas &atlas, unsigned characterSize)
+{
+    for (size_t s = 0; s < atlas.sizes.size(); ++s)
+    {
+        if (atlas.sizes[s].characterSize == characterSize)
+            return static_cast<int>(s);
+    }
+    return -1;
+}
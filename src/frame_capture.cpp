@@ -0,0 +1,243 @@
+#include "frame_capture.hpp"
+#include <SFML/OpenGL.hpp>
+#include <csignal>
+#include <sys/wait.h>
+
+bool writeBottomUpRows(std::FILE *stream, const CaptureFrame &frame)
+{
+    const size_t rowBytes = static_cast<size_t>(frame.width) * 4;
+    for (unsigned row = frame.height; row-- > 0;)
+    {
+        if (std::fwrite(&frame.pixels[row * rowBytes], 1, rowBytes, stream) != rowBytes)
+            return false;
+    }
+    return true;
+}
+
+bool savePng(const CaptureFrame &frame, const std::string &path)
+{
+    sf::Image image;
+    image.create(frame.width, frame.height, frame.pixels.data());
+    image.flipVertically();
+    return image.saveToFile(path);
+}
+
+void openCaptureStream(FrameCapture &capture, unsigned width, unsigned height)
+{
+    if (capture.format == CaptureFormat::Raw)
+    {
+        std::string path = capture.outputPrefix + "_" + std::to_string(width) + "x" + std::to_string(height) + ".rgba";
+        capture.stream = std::fopen(path.c_str(), "wb");
+        capture.streamIsPipe = false;
+    }
+    else
+    {
+        std::string command = capture.pipeCommand;
+        if (command.empty())
+        {
+            command = "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgba -s " + std::to_string(width) + "x" +
+                      std::to_string(height) + " -r 60 -i - -pix_fmt yuv420p " + capture.outputPrefix + ".mp4";
+        }
+        std::signal(SIGPIPE, SIG_IGN);
+        capture.stream = popen(command.c_str(), "w");
+        capture.streamIsPipe = true;
+    }
+    if (!capture.stream)
+    {
+        std::cout << "Could not open capture output\n";
+        capture.streamFailed = true;
+    }
+}
+
+void closeCaptureStream(FrameCapture &capture)
+{
+    if (!capture.stream)
+        return;
+    if (capture.streamIsPipe)
+    {
+        int status = pclose(capture.stream);
+        if (status != 0)
+            std::cout << "Capture encoder exited with status " << (WIFEXITED(status) ? WEXITSTATUS(status) : status) << "\n";
+    }
+    else if (std::fclose(capture.stream) != 0)
+        std::cout << "Could not finish the capture file\n";
+    capture.stream = nullptr;
+}
+
+void runCaptureEncoder(FrameCapture &capture)
+{
+    for (;;)
+    {
+        CaptureTask task;
+        {
+            std::unique_lock<std::mutex> lock(capture.mutex);
+            capture.wake.wait(lock, [&]() { return capture.stopping || !capture.queue.empty(); });
+            if (capture.queue.empty())
+                return;
+            task = std::move(capture.queue.front());
+            capture.queue.pop_front();
+        }
+
+        switch (task.type)
+        {
+        case CaptureTaskType::StartRecording:
+            if (capture.format != CaptureFormat::Png)
+                openCaptureStream(capture, task.width, task.height);
+            break;
+        case CaptureTaskType::StopRecording:
+            closeCaptureStream(capture);
+            break;
+        case CaptureTaskType::Screenshot:
+            if (savePng(*task.frame, task.path))
+                std::cout << "Screenshot saved as " << task.path << "\n";
+            break;
+        case CaptureTaskType::Frame:
+            if (capture.format == CaptureFormat::Png)
+            {
+                savePng(*task.frame, task.path);
+                capture.writtenFrames++;
+            }
+            else if (capture.stream && writeBottomUpRows(capture.stream, *task.frame))
+                capture.writtenFrames++;
+            else if (capture.stream)
+            {
+                std::cout << "Capture output stopped taking frames\n";
+                closeCaptureStream(capture);
+                capture.streamFailed = true;
+            }
+            break;
+        }
+
+        if (task.frame)
+        {
+            std::lock_guard<std::mutex> lock(capture.mutex);
+            capture.freeFrames.push_back(task.frame);
+        }
+    }
+}
+
+void startFrameCapture(FrameCapture &capture)
+{
+    capture.frames.resize(CAPTURE_POOL_SIZE);
+    for (auto &frame : capture.frames)
+        capture.freeFrames.push_back(&frame);
+
+    // PNG frames are independent and slow to encode, so they get several encoders.
+    // Stream formats need frames in order and use one.
+    unsigned encoderCount = 1;
+    if (capture.format == CaptureFormat::Png)
+        encoderCount = std::max(1u, std::min(MAX_PNG_ENCODERS, std::thread::hardware_concurrency() / 2));
+    for (unsigned i = 0; i < encoderCount; ++i)
+        capture.encoders.emplace_back(runCaptureEncoder, std::ref(capture));
+}
+
+void stopFrameCapture(FrameCapture &capture)
+{
+    {
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.stopping = true;
+    }
+    capture.wake.notify_all();
+    for (auto &encoder : capture.encoders)
+        encoder.join();
+    capture.encoders.clear();
+    closeCaptureStream(capture);
+}
+
+void pushCaptureTask(FrameCapture &capture, CaptureTask task)
+{
+    {
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.queue.push_back(std::move(task));
+    }
+    capture.wake.notify_one();
+}
+
+size_t captureQueueDepth(FrameCapture &capture)
+{
+    std::lock_guard<std::mutex> lock(capture.mutex);
+    return capture.queue.size();
+}
+
+CaptureFrame *readWindowFrame(FrameCapture &capture, sf::RenderWindow &window)
+{
+    CaptureFrame *frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        if (capture.freeFrames.empty())
+            return nullptr;
+        frame = capture.freeFrames.back();
+        capture.freeFrames.pop_back();
+    }
+
+    sf::Vector2u size = window.getSize();
+    frame->width = size.x;
+    frame->height = size.y;
+    frame->pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+
+    window.setActive(true);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels.data());
+    return frame;
+}
+
+void captureScreenshot(FrameCapture &capture, sf::RenderWindow &window, const std::string &path)
+{
+    CaptureFrame *frame = readWindowFrame(capture, window);
+    if (!frame)
+    {
+        capture.droppedFrames++;
+        std::cout << "Screenshot skipped, capture queue is full\n";
+        return;
+    }
+    pushCaptureTask(capture, CaptureTask{CaptureTaskType::Screenshot, frame, path});
+}
+
+void toggleRecording(FrameCapture &capture, sf::RenderWindow &window)
+{
+    if (!capture.recording)
+    {
+        capture.recording = true;
+        capture.recordedFrames = 0;
+        capture.writtenFrames = 0;
+        capture.droppedFrames = 0;
+        capture.streamFailed = false;
+        sf::Vector2u size = window.getSize();
+        pushCaptureTask(capture, CaptureTask{CaptureTaskType::StartRecording, nullptr, "", size.x, size.y});
+        std::cout << "Recording started\n";
+        return;
+    }
+
+    capture.recording = false;
+    pushCaptureTask(capture, CaptureTask{CaptureTaskType::StopRecording});
+    std::cout << "Recording stopped: " << capture.recordedFrames << " frames captured, "
+              << capture.droppedFrames << " dropped, queue depth " << captureQueueDepth(capture) << "\n";
+}
+
+void recordFrame(FrameCapture &capture, sf::RenderWindow &window)
+{
+    if (!capture.recording)
+        return;
+    if (capture.streamFailed.exchange(false))
+    {
+        toggleRecording(capture, window);
+        return;
+    }
+
+    CaptureFrame *frame = readWindowFrame(capture, window);
+    if (!frame)
+    {
+        capture.droppedFrames++;
+        return;
+    }
+
+    capture.recordedFrames++;
+    std::string path;
+    if (capture.format == CaptureFormat::Png)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "_%06llu.png", static_cast<unsigned long long>(capture.recordedFrames));
+        path = capture.outputPrefix + name;
+    }
+    pushCaptureTask(capture, CaptureTask{CaptureTaskType::Frame, frame, path});
+}
@@ -0,0 +1,268 @@
+#include "hud.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+void createHud(Hud &hud, const GlyphAtlas &atlas)
+{
+    hud.atlas = &atlas;
+    hud.vertices.clear();
+    hud.labels.clear();
+    hud.dirtyLabels.clear();
+    hud.dirty.clear();
+}
+
+void markHudDirty(Hud &hud, int label)
+{
+    if (!hud.dirty[label])
+    {
+        hud.dirty[label] = 1;
+        hud.dirtyLabels.push_back(label);
+    }
+}
+
+int addHudLabel(Hud &hud, unsigned characterSize, sf::Color color, sf::Vector2f position, size_t capacity)
+{
+    HudLabel label;
+    label.size = hud.atlas ? atlasSizeIndex(*hud.atlas, characterSize) : -1;
+    label.firstVertex = hud.vertices.size();
+    label.capacity = capacity;
+    label.position = position;
+    label.color = color;
+    label.text.reserve(capacity);
+    hud.vertices.resize(hud.vertices.size() + capacity * 6, sf::Vertex(sf::Vector2f(), sf::Color::Transparent));
+
+    hud.labels.push_back(std::move(label));
+    hud.dirty.push_back(0);
+    return static_cast<int>(hud.labels.size()) - 1;
+}
+
+void removeHudLabels(Hud &hud, size_t first)
+{
+    // Slots are appended in label order, so the removed ones end the array
+    if (first < hud.labels.size())
+        hud.vertices.resize(hud.labels[first].firstVertex);
+    hud.labels.resize(std::min(first, hud.labels.size()));
+    hud.dirty.resize(hud.labels.size());
+    hud.dirtyLabels.erase(std::remove_if(hud.dirtyLabels.begin(), hud.dirtyLabels.end(),
+                                         [first](int label) { return static_cast<size_t>(label) >= first; }),
+                          hud.dirtyLabels.end());
+}
+
+void setHudText(Hud &hud, int label, const char *first, const char *last)
+{
+    HudLabel &target = hud.labels[label];
+    last = std::min(last, first + target.capacity);
+    if (target.text.size() == static_cast<size_t>(last - first) && std::equal(first, last, target.text.begin()))
+        return;
+    target.text.assign(first, last);
+    markHudDirty(hud, label);
+}
+
+void setHudText(Hud &hud, int label, const char *text)
+{
+    setHudText(hud, label, text, text + std::strlen(text));
+}
+
+void setHudText(Hud &hud, int label, const std::string &text)
+{
+    setHudText(hud, label, text.data(), text.data() + text.size());
+}
+
+void setHudPosition(Hud &hud, int label, sf::Vector2f position)
+{
+    if (hud.labels[label].position == position)
+        return;
+    hud.labels[label].position = position;
+    markHudDirty(hud, label);
+}
+
+void setHudHidden(Hud &hud, int label, bool hidden)
+{
+    if (hud.labels[label].hidden == hidden)
+        return;
+    hud.labels[label].hidden = hidden;
+    markHudDirty(hud, label);
+}
+
+char *appendText(char *first, char *last, const char *text)
+{
+    while (first < last && *text)
+        *first++ = *text++;
+    return first;
+}
+
+char *formatCount(char *first, char *last, std::uint64_t value)
+{
+    std::to_chars_result result = std::to_chars(first, last, value);
+    return result.ec == std::errc() ? result.ptr : first;
+}
+
+// Fixed point through integer conversion, which every C++17 library has for to_chars
+char *formatFixed(char *first, char *last, double value, int decimals)
+{
+    if (value < 0.0)
+        first = appendText(first, last, "-");
+    std::uint64_t scale = 1;
+    for (int d = 0; d < decimals; ++d)
+        scale *= 10;
+    std::uint64_t scaled = static_cast<std::uint64_t>(std::llround(std::abs(value) * scale));
+    first = formatCount(first, last, scaled / scale);
+    if (decimals <= 0)
+        return first;
+
+    first = appendText(first, last, ".");
+    char digits[20];
+    char *end = formatCount(digits, digits + sizeof(digits), scaled % scale);
+    for (std::ptrdiff_t pad = decimals - (end - digits); pad > 0; --pad)
+        first = appendText(first, last, "0");
+    for (const char *digit = digits; first < last && digit < end; ++digit)
+        *first++ = *digit;
+    return first;
+}
+
+char *formatScientific(char *first, char *last, double value, int decimals)
+{
+    int exponent = value != 0.0 ? static_cast<int>(std::floor(std::log10(std::abs(value)))) : 0;
+    double mantissa = value / std::pow(10.0, exponent);
+    // Rounding can carry into the next power of ten
+    if (std::abs(mantissa) + 0.5 * std::pow(10.0, -decimals) >= 10.0)
+    {
+        mantissa /= 10.0;
+        exponent++;
+    }
+    first = formatFixed(first, last, mantissa, decimals);
+    first = appendText(first, last, exponent < 0 ? "e-" : "e+");
+    if (std::abs(exponent) < 10)
+        first = appendText(first, last, "0");
+    return formatCount(first, last, static_cast<std::uint64_t>(std::abs(exponent)));
+}
+
+void setHudCount(Hud &hud, int label, const char *prefix, std::uint64_t value, const char *suffix)
+{
+    char buffer[HUD_NUMBER_CHARS];
+    char *last = buffer + sizeof(buffer);
+    char *end = appendText(formatCount(appendText(buffer, last, prefix), last, value), last, suffix);
+    setHudText(hud, label, buffer, end);
+}
+
+void setHudFixed(Hud &hud, int label, const char *prefix, double value, int decimals, const char *suffix)
+{
+    char buffer[HUD_NUMBER_CHARS];
+    char *last = buffer + sizeof(buffer);
+    char *end = appendText(formatFixed(appendText(buffer, last, prefix), last, value, decimals), last, suffix);
+    setHudText(hud, label, buffer, end);
+}
+
+// Same glyph placement as sf::Text: baseline one character size down, kerning
+// between pairs, one pixel of padding around each glyph. Characters the atlas
+// does not have are skipped.
+void layoutHudLabel(Hud &hud, int id)
+{
+    HudLabel &label = hud.labels[id];
+    sf::Vertex *vertices = hud.vertices.data() + label.firstVertex;
+    size_t count = 0;
+
+    if (!label.hidden && label.size >= 0)
+    {
+        const AtlasSize &size = hud.atlas->sizes[label.size];
+        const float padding = 1.0f;
+        float x = 0.0f;
+        float y = static_cast<float>(size.characterSize);
+        float firstLineWidth = -1.0f;
+        unsigned previous = 0;
+        for (char ch : label.text)
+        {
+            unsigned character = static_cast<unsigned char>(ch);
+            if (character == '\n')
+            {
+                if (firstLineWidth < 0.0f)
+                    firstLineWidth = x;
+                x = 0.0f;
+                y += size.lineSpacing;
+                previous = 0;
+                continue;
+            }
+            if (character < ATLAS_FIRST_CHARACTER || character > ATLAS_LAST_CHARACTER)
+                continue;
+            if (previous != 0)
+                x += atlasKerning(size, previous, character);
+            previous = character;
+
+            const sf::Glyph &glyph = atlasGlyph(size, character);
+            if (character != ' ')
+            {
+                float left = x + glyph.bounds.left - padding;
+                float top = y + glyph.bounds.top - padding;
+                float right = x + glyph.bounds.left + glyph.bounds.width + padding;
+                float bottom = y + glyph.bounds.top + glyph.bounds.height + padding;
+                float u1 = glyph.textureRect.left - padding;
+                float v1 = glyph.textureRect.top - padding;
+                float u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+                float v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+
+                sf::Vertex *quad = vertices + count;
+                quad[0] = sf::Vertex(sf::Vector2f(left, top), label.color, sf::Vector2f(u1, v1));
+                quad[1] = sf::Vertex(sf::Vector2f(right, top), label.color, sf::Vector2f(u2, v1));
+                quad[2] = sf::Vertex(sf::Vector2f(left, bottom), label.color, sf::Vector2f(u1, v2));
+                quad[3] = sf::Vertex(sf::Vector2f(left, bottom), label.color, sf::Vector2f(u1, v2));
+                quad[4] = sf::Vertex(sf::Vector2f(right, top), label.color, sf::Vector2f(u2, v1));
+                quad[5] = sf::Vertex(sf::Vector2f(right, bottom), label.color, sf::Vector2f(u2, v2));
+                count += 6;
+            }
+            x += glyph.advance;
+        }
+        if (firstLineWidth < 0.0f)
+            firstLineWidth = x;
+
+        sf::Transform transform;
+        transform.translate(label.position).rotate(label.rotation);
+        if (label.centered)
+            transform.translate(-firstLineWidth / 2.0f, 0.0f);
+        for (size_t v = 0; v < count; ++v)
+            vertices[v].position = transform.transformPoint(vertices[v].position);
+    }
+
+    // Collapse what the previous, longer text left behind
+    for (size_t v = count; v < label.vertexCount; ++v)
+        vertices[v] = sf::Vertex(sf::Vector2f(), sf::Color::Transparent);
+    label.vertexCount = count;
+}
+
+void updateHud(Hud &hud)
+{
+    for (int label : hud.dirtyLabels)
+    {
+        layoutHudLabel(hud, label);
+        hud.dirty[label] = 0;
+    }
+    hud.dirtyLabels.clear();
+}
+
+sf::FloatRect hudLabelBounds(const Hud &hud, int label)
+{
+    const HudLabel &target = hud.labels[label];
+    if (target.vertexCount == 0)
+        return sf::FloatRect(target.position, sf::Vector2f());
+    const sf::Vertex *vertices = hud.vertices.data() + target.firstVertex;
+    sf::Vector2f low = vertices[0].position, high = vertices[0].position;
+    for (size_t v = 1; v < target.vertexCount; ++v)
+    {
+        low.x = std::min(low.x, vertices[v].position.x);
+        low.y = std::min(low.y, vertices[v].position.y);
+        high.x = std::max(high.x, vertices[v].position.x);
+        high.y = std::max(high.y, vertices[v].position.y);
+    }
+    return sf::FloatRect(low, high - low);
+}
+
+int drawHud(const Hud &hud, sf::RenderTarget &target)
+{
+    if (hud.vertices.empty() || !hud.atlas)
+        return 0;
+    sf::RenderStates states;
+    states.texture = &hud.atlas->texture;
+    target.draw(hud.vertices.data(), hud.vertices.size(), sf::Triangles, states);
+    return 1;
+}
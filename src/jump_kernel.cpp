@@ -0,0 +1,177 @@
+#include "jump_kernel.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SSR_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+size_t advanceJumpsScalar(const JumpBatch &batch, size_t begin, float progressStep)
+{
+    size_t landedCount = 0;
+    for (size_t i = begin; i < batch.count; ++i)
+    {
+        if (!batch.isJumping[i])
+        {
+            batch.landed[i] = 0;
+            continue;
+        }
+        float progress = batch.progress[i] + progressStep;
+        bool landed = progress >= 1.0f;
+        progress = landed ? 1.0f : progress;
+        batch.progress[i] = progress;
+
+        float t = progress * progress * (3.0f - 2.0f * progress);
+        float arcOffset = -JUMP_ARC_HEIGHT * 4.0f * progress * (1.0f - progress);
+        batch.position[2 * i] = batch.startX[i] + (batch.targetX[i] - batch.startX[i]) * t;
+        batch.position[2 * i + 1] = batch.startY[i] + (batch.targetY[i] - batch.startY[i]) * t + arcOffset;
+        batch.landed[i] = landed ? 1 : 0;
+        landedCount += landed ? 1 : 0;
+    }
+    return landedCount;
+}
+
+#ifdef SSR_X86_KERNELS
+
+// Writes one landed byte per lane of a movemask
+void storeLandedLanes(std::uint8_t *landed, int mask, int lanes)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+        landed[lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+}
+
+__attribute__((target("avx2"))) size_t advanceJumpsAvx2(const JumpBatch &batch, float progressStep)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 arc = _mm256_set1_ps(-JUMP_ARC_HEIGHT * 4.0f);
+    const __m256 step = _mm256_set1_ps(progressStep);
+
+    size_t landedCount = 0;
+    size_t i = 0;
+    for (; i + 8 <= batch.count; i += 8)
+    {
+        __m128i flagBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(batch.isJumping + i));
+        __m256i flags = _mm256_cvtepu8_epi32(flagBytes);
+        __m256 jumping = _mm256_castsi256_ps(_mm256_cmpgt_epi32(flags, _mm256_setzero_si256()));
+        if (_mm256_movemask_ps(jumping) == 0)
+        {
+            std::memset(batch.landed + i, 0, 8);
+            continue;
+        }
+
+        __m256 oldProgress = _mm256_loadu_ps(batch.progress + i);
+        __m256 progress = _mm256_add_ps(oldProgress, step);
+        __m256 done = _mm256_and_ps(_mm256_cmp_ps(progress, one, _CMP_GE_OQ), jumping);
+        progress = _mm256_min_ps(progress, one);
+        _mm256_storeu_ps(batch.progress + i, _mm256_blendv_ps(oldProgress, progress, jumping));
+
+        __m256 t = _mm256_mul_ps(_mm256_mul_ps(progress, progress), _mm256_sub_ps(three, _mm256_mul_ps(two, progress)));
+        __m256 arcOffset = _mm256_mul_ps(_mm256_mul_ps(arc, progress), _mm256_sub_ps(one, progress));
+        __m256 sx = _mm256_loadu_ps(batch.startX + i);
+        __m256 sy = _mm256_loadu_ps(batch.startY + i);
+        __m256 x = _mm256_add_ps(sx, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.targetX + i), sx), t));
+        __m256 y = _mm256_add_ps(_mm256_add_ps(sy, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.targetY + i), sy), t)), arcOffset);
+
+        // Back to x, y pairs: unpack works within 128-bit halves, the permutes put the halves in order
+        __m256 low = _mm256_unpacklo_ps(x, y);
+        __m256 high = _mm256_unpackhi_ps(x, y);
+        __m256 maskLow = _mm256_unpacklo_ps(jumping, jumping);
+        __m256 maskHigh = _mm256_unpackhi_ps(jumping, jumping);
+        float *out = batch.position + 2 * i;
+        _mm256_storeu_ps(out, _mm256_blendv_ps(_mm256_loadu_ps(out), _mm256_permute2f128_ps(low, high, 0x20),
+                                               _mm256_permute2f128_ps(maskLow, maskHigh, 0x20)));
+        _mm256_storeu_ps(out + 8, _mm256_blendv_ps(_mm256_loadu_ps(out + 8), _mm256_permute2f128_ps(low, high, 0x31),
+                                                   _mm256_permute2f128_ps(maskLow, maskHigh, 0x31)));
+
+        int doneMask = _mm256_movemask_ps(done);
+        storeLandedLanes(batch.landed + i, doneMask, 8);
+        landedCount += __builtin_popcount(doneMask);
+    }
+    return landedCount + advanceJumpsScalar(batch, i, progressStep);
+}
+
+__attribute__((target("sse4.1"))) size_t advanceJumpsSse41(const JumpBatch &batch, float progressStep)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 arc = _mm_set1_ps(-JUMP_ARC_HEIGHT * 4.0f);
+    const __m128 step = _mm_set1_ps(progressStep);
+
+    size_t landedCount = 0;
+    size_t i = 0;
+    for (; i + 4 <= batch.count; i += 4)
+    {
+        int flagWord;
+        std::memcpy(&flagWord, batch.isJumping + i, sizeof(flagWord));
+        __m128i flags = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(flagWord));
+        __m128 jumping = _mm_castsi128_ps(_mm_cmpgt_epi32(flags, _mm_setzero_si128()));
+        if (_mm_movemask_ps(jumping) == 0)
+        {
+            std::memset(batch.landed + i, 0, 4);
+            continue;
+        }
+
+        __m128 oldProgress = _mm_loadu_ps(batch.progress + i);
+        __m128 progress = _mm_add_ps(oldProgress, step);
+        __m128 done = _mm_and_ps(_mm_cmpge_ps(progress, one), jumping);
+        progress = _mm_min_ps(progress, one);
+        _mm_storeu_ps(batch.progress + i, _mm_blendv_ps(oldProgress, progress, jumping));
+
+        __m128 t = _mm_mul_ps(_mm_mul_ps(progress, progress), _mm_sub_ps(three, _mm_mul_ps(two, progress)));
+        __m128 arcOffset = _mm_mul_ps(_mm_mul_ps(arc, progress), _mm_sub_ps(one, progress));
+        __m128 sx = _mm_loadu_ps(batch.startX + i);
+        __m128 sy = _mm_loadu_ps(batch.startY + i);
+        __m128 x = _mm_add_ps(sx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.targetX + i), sx), t));
+        __m128 y = _mm_add_ps(_mm_add_ps(sy, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.targetY + i), sy), t)), arcOffset);
+
+        float *out = batch.position + 2 * i;
+        _mm_storeu_ps(out, _mm_blendv_ps(_mm_loadu_ps(out), _mm_unpacklo_ps(x, y), _mm_unpacklo_ps(jumping, jumping)));
+        _mm_storeu_ps(out + 4, _mm_blendv_ps(_mm_loadu_ps(out + 4), _mm_unpackhi_ps(x, y), _mm_unpackhi_ps(jumping, jumping)));
+
+        int doneMask = _mm_movemask_ps(done);
+        storeLandedLanes(batch.landed + i, doneMask, 4);
+        landedCount += __builtin_popcount(doneMask);
+    }
+    return landedCount + advanceJumpsScalar(batch, i, progressStep);
+}
+
+#endif
+
+JumpKernel selectJumpKernel()
+{
+#ifdef SSR_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return JumpKernel::Avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return JumpKernel::Sse41;
+#endif
+    return JumpKernel::Scalar;
+}
+
+const char *jumpKernelName(JumpKernel kernel)
+{
+    switch (kernel)
+    {
+    case JumpKernel::Avx2:
+        return "avx2";
+    case JumpKernel::Sse41:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
+
+size_t advanceJumps(const JumpBatch &batch, float progressStep, JumpKernel kernel)
+{
+#ifdef SSR_X86_KERNELS
+    if (kernel == JumpKernel::Avx2)
+        return advanceJumpsAvx2(batch, progressStep);
+    if (kernel == JumpKernel::Sse41)
+        return advanceJumpsSse41(batch, progressStep);
+#endif
+    return advanceJumpsScalar(batch, 0, progressStep);
+}
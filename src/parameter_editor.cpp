@@ -0,0 +1,136 @@
+#include "parameter_editor.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+const char *fieldName(EditField field)
+{
+    switch (field)
+    {
+    case EditField::Factor:
+        return "Factor";
+    case EditField::States:
+        return "States";
+    case EditField::Speed:
+        return "Speed";
+    case EditField::Seed:
+        return "Seed";
+    }
+    return "";
+}
+
+void layoutEditor(ParameterEditor &editor)
+{
+    setHudText(editor.hud, editor.label, std::string(fieldName(editor.field)) + ": " + editor.text + "_   Tab next, Enter apply, Esc close");
+    updateHud(editor.hud);
+    sf::FloatRect bounds = hudLabelBounds(editor.hud, editor.label);
+    editor.background.setPosition(bounds.left - 4.0f, bounds.top - 4.0f);
+    editor.background.setSize(sf::Vector2f(bounds.width + 8.0f, bounds.height + 8.0f));
+}
+
+void createParameterEditor(ParameterEditor &editor, const GlyphAtlas &atlas, sf::Vector2f position)
+{
+    createHud(editor.hud, atlas);
+    editor.label = addHudLabel(editor.hud, 13, sf::Color::White, position, 64);
+    editor.background.setFillColor(sf::Color(40, 40, 60, 220));
+    editor.background.setOutlineColor(sf::Color(200, 200, 255));
+    editor.background.setOutlineThickness(1.0f);
+}
+
+void openParameterEditor(ParameterEditor &editor, EditField field, const RenderSnapshot &snapshot)
+{
+    editor.open = true;
+    editor.field = field;
+    switch (field)
+    {
+    case EditField::Factor:
+        editor.text = std::to_string(snapshot.multiplicativeFactor).substr(0, 4);
+        break;
+    case EditField::States:
+        editor.text = std::to_string(snapshot.boxCount - 1);
+        break;
+    case EditField::Speed:
+        editor.text = std::to_string(snapshot.simulationSpeed).substr(0, 3);
+        break;
+    case EditField::Seed:
+        editor.text = std::to_string(snapshot.seed);
+        break;
+    }
+    layoutEditor(editor);
+}
+
+// Sends the typed value, clamped to the range of its parameter. Text that is
+// not a number is dropped.
+void submitEditor(const ParameterEditor &editor, Simulation &sim)
+{
+    const char *text = editor.text.c_str();
+    char *end = nullptr;
+    double value = std::strtod(text, &end);
+    if (end == text)
+        return;
+
+    switch (editor.field)
+    {
+    case EditField::Factor:
+        pushCommand(sim, SimulationCommandType::SetFactor, std::min(std::max(value, 1.0 * MIN_FACTOR), 1.0 * MAX_FACTOR));
+        break;
+    case EditField::States:
+        pushCommand(sim, SimulationCommandType::SetStates, std::min(std::max(std::floor(value), 1.0), MAX_BOX_COUNT - 1.0));
+        break;
+    case EditField::Speed:
+        pushCommand(sim, SimulationCommandType::SetSpeed, std::min(std::max(value, 1.0 * MIN_SPEED), 1.0 * MAX_SPEED));
+        break;
+    case EditField::Seed:
+        pushCommand(sim, SimulationCommandType::SetSeed,
+                    std::min(std::floor(value), static_cast<double>(std::numeric_limits<std::uint32_t>::max())));
+        break;
+    }
+}
+
+bool handleEditorEvent(ParameterEditor &editor, const sf::Event &event, const RenderSnapshot &snapshot, Simulation &sim)
+{
+    if (!editor.open || (event.type != sf::Event::KeyPressed && event.type != sf::Event::TextEntered))
+        return false;
+
+    if (event.type == sf::Event::KeyPressed)
+    {
+        if (event.key.code == sf::Keyboard::Escape)
+            editor.open = false;
+        return true;
+    }
+
+    // Control keys arrive as text too, which works the same on every SFML version
+    std::uint32_t character = event.text.unicode;
+    if (character == '\r' || character == '\n')
+    {
+        submitEditor(editor, sim);
+        editor.open = false;
+        return true;
+    }
+    if (character == '\t')
+    {
+        openParameterEditor(editor, static_cast<EditField>((static_cast<int>(editor.field) + 1) % EDIT_FIELD_COUNT), snapshot);
+        return true;
+    }
+    if (character == '\b')
+    {
+        if (!editor.text.empty())
+            editor.text.pop_back();
+    }
+    else if (editor.text.size() < EDITOR_MAX_CHARS &&
+             ((character >= '0' && character <= '9') ||
+              (character == '.' && (editor.field == EditField::Factor || editor.field == EditField::Speed))))
+        editor.text.push_back(static_cast<char>(character));
+    layoutEditor(editor);
+    return true;
+}
+
+int drawParameterEditor(const ParameterEditor &editor, sf::RenderTarget &target)
+{
+    if (!editor.open)
+        return 0;
+    target.draw(editor.background);
+    return 1 + drawHud(editor.hud, target);
+}
@@ -0,0 +1,215 @@
+#include "physics.hpp"
+#include "simulation.hpp"
+#include <cmath>
+
+void initPhysics(PhysicsWorld &physics, const BoxLayout &layout)
+{
+    physics.ballRadius = std::min(BALL_RADIUS, 0.35f * layout.boxWidth);
+    physics.drawOffset = BALL_RADIUS - physics.ballRadius;
+
+    // Counter-clockwise around the steps, so the one-sided edges face the balls.
+    // The drawn 2 px gaps between boxes are left out.
+    const int last = layout.boxCount - 1;
+    std::vector<b2Vec2> outline;
+    outline.reserve(2 * layout.boxCount + 2);
+    outline.push_back(b2Vec2(0.0f, 0.0f));
+    outline.push_back(b2Vec2(WINDOW_WIDTH / SCALE, 0.0f));
+    outline.push_back(b2Vec2(WINDOW_WIDTH / SCALE, layout.height(last)));
+    for (int box = last; box > 0; --box)
+    {
+        outline.push_back(b2Vec2(layout.x(box), layout.height(box)));
+        outline.push_back(b2Vec2(layout.x(box), layout.height(box - 1)));
+    }
+    outline.push_back(b2Vec2(0.0f, layout.height(0)));
+
+    b2ChainShape chain;
+    chain.CreateLoop(outline.data(), static_cast<int32>(outline.size()));
+    b2FixtureDef fixture;
+    fixture.shape = &chain;
+    fixture.friction = 0.4f;
+    fixture.filter.categoryBits = PHYSICS_STAIRS_CATEGORY;
+    fixture.filter.maskBits = PHYSICS_BALL_CATEGORY;
+
+    b2BodyDef bodyDef;
+    physics.stairs = physics.world.CreateBody(&bodyDef);
+    physics.stairs->CreateFixture(&fixture);
+}
+
+void rebuildPhysics(PhysicsWorld &physics, const BoxLayout &layout)
+{
+    for (b2Body *body : physics.freeBodies)
+        physics.world.DestroyBody(body);
+    physics.freeBodies.clear();
+    physics.bodyCount = 0;
+    if (physics.stairs)
+        physics.world.DestroyBody(physics.stairs);
+    initPhysics(physics, layout);
+}
+
+b2Vec2 toWorld(const PhysicsWorld &physics, sf::Vector2f pixel)
+{
+    return b2Vec2(pixel.x / SCALE, (WINDOW_HEIGHT - pixel.y) / SCALE - physics.drawOffset);
+}
+
+sf::Vector2f toPixels(const PhysicsWorld &physics, b2Vec2 position)
+{
+    return sf::Vector2f(position.x * SCALE, WINDOW_HEIGHT - (position.y + physics.drawOffset) * SCALE);
+}
+
+b2Body *acquireBody(PhysicsWorld &physics, b2Vec2 position)
+{
+    if (!physics.freeBodies.empty())
+    {
+        b2Body *body = physics.freeBodies.back();
+        physics.freeBodies.pop_back();
+        body->SetTransform(position, 0.0f);
+        body->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+        body->SetAngularVelocity(0.0f);
+        body->SetEnabled(true);
+        body->SetAwake(true);
+        return body;
+    }
+
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position = position;
+    b2Body *body = physics.world.CreateBody(&bodyDef);
+
+    b2CircleShape circle;
+    circle.m_radius = physics.ballRadius;
+    b2FixtureDef fixture;
+    fixture.shape = &circle;
+    fixture.density = 1.0f;
+    fixture.friction = 0.4f;
+    fixture.restitution = 0.2f;
+    fixture.filter.categoryBits = PHYSICS_BALL_CATEGORY;
+    fixture.filter.maskBits = PHYSICS_STAIRS_CATEGORY;
+    body->CreateFixture(&fixture);
+    physics.bodyCount++;
+    return body;
+}
+
+void releaseBody(PhysicsWorld &physics, b2Body *body)
+{
+    // A disabled body leaves the broad-phase and is skipped by every step
+    body->SetEnabled(false);
+    physics.freeBodies.push_back(body);
+}
+
+void releaseBallBodies(PhysicsWorld &physics, BallStore &balls, size_t first)
+{
+    for (size_t i = first; i < balls.size(); ++i)
+    {
+        if (balls.body[i])
+            releaseBody(physics, balls.body[i]);
+        balls.body[i] = nullptr;
+    }
+}
+
+float flightTime(const Simulation &sim, size_t i)
+{
+    // With run dx, drop dy and landing slope k the arc y(x) meets the target
+    // with slope -k when g T^2 / 2 = k dx - dy
+    const BallStore &balls = sim.balls;
+    float dx = (balls.targetX[i] - balls.startX[i]) / SCALE;
+    float dy = (balls.targetY[i] - balls.startY[i]) / SCALE;
+    return std::sqrt(2.0f * std::max(PHYSICS_LANDING_SLOPE * std::abs(dx) - dy, 0.0f) / PHYSICS_GRAVITY);
+}
+
+void launchBall(Simulation &sim, size_t i)
+{
+    PhysicsWorld &physics = *sim.physics;
+    BallStore &balls = sim.balls;
+    b2Vec2 start = toWorld(physics, sf::Vector2f(balls.startX[i], balls.startY[i]));
+    b2Vec2 target = toWorld(physics, balls.target(i));
+
+    // Box2D updates velocity before position, so after n steps of h the height is
+    // y0 + vy n h - g h^2 n (n + 1) / 2. Solving that for a whole number of steps
+    // puts the body on the target exactly, not a fall of g T h / 2 short of it.
+    const float h = physics.substep;
+    const float T = std::max(std::round(flightTime(sim, i) / h), 1.0f) * h;
+    b2Vec2 velocity((target.x - start.x) / T, (target.y - start.y) / T + PHYSICS_GRAVITY * (T + h) / 2.0f);
+
+    if (!balls.body[i])
+        balls.body[i] = acquireBody(physics, start);
+    else
+        balls.body[i]->SetTransform(start, 0.0f);
+    balls.body[i]->SetLinearVelocity(velocity);
+    balls.position[i] = toPixels(physics, start);
+    balls.jumpProgress[i] = 0.0f;
+}
+
+// True once the body of ball i touches the stairs above its target box. The
+// launch contact with the box it leaves is never within that span.
+bool hasLanded(const Simulation &sim, size_t i)
+{
+    const BallStore &balls = sim.balls;
+    const b2Body *body = balls.body[i];
+    if (std::abs(body->GetPosition().x - balls.targetX[i] / SCALE) > sim.layout.boxWidth / 2.0f)
+        return false;
+    for (const b2ContactEdge *edge = body->GetContactList(); edge; edge = edge->next)
+    {
+        if (edge->contact->IsTouching())
+            return true;
+    }
+    return false;
+}
+
+void stepPhysics(Simulation &sim, float simDt)
+{
+    PhysicsWorld &physics = *sim.physics;
+    BallStore &balls = sim.balls;
+    const size_t count = balls.size();
+
+    // Substeps keep the world step short at any simulation speed
+    const int substeps = std::max(1, static_cast<int>(std::ceil(simDt / PHYSICS_MAX_SUBSTEP)));
+    physics.substep = simDt / substeps;
+
+    // Jumps restored from a checkpoint start over from their box
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (balls.isJumping[i] && !balls.body[i])
+            launchBall(sim, i);
+    }
+
+    for (int s = 0; s < substeps; ++s)
+    {
+        physics.world.Step(physics.substep, PHYSICS_VELOCITY_ITERATIONS, PHYSICS_POSITION_ITERATIONS);
+
+        // A ball stops where it first touches its target, before it bounces or rolls off
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (balls.isJumping[i] && balls.body[i]->IsEnabled() && hasLanded(sim, i))
+                balls.body[i]->SetEnabled(false);
+        }
+    }
+
+    // Same order as the animated step: backwards, children launched but not advanced
+    for (size_t i = count; i-- > 0;)
+    {
+        if (balls.isJumping[i])
+        {
+            balls.position[i] = toPixels(physics, balls.body[i]->GetPosition());
+            balls.jumpProgress[i] += simDt / flightTime(sim, i);
+            if (balls.body[i]->IsEnabled() && balls.jumpProgress[i] < PHYSICS_FLIGHT_TIMEOUT)
+                continue;
+
+            releaseBody(physics, balls.body[i]);
+            balls.body[i] = nullptr;
+            balls.position[i] = balls.target(i);
+            balls.currentBox[i] = balls.nextBox[i];
+            balls.isJumping[i] = 0;
+            balls.restStart[i] = sim.simTime;
+        }
+        else if (!balls.hasReachedEnd[i] && sim.simTime - balls.restStart[i] > sim.waitTime)
+        {
+            size_t firstSpawned = balls.size();
+            if (!leaveBox(sim, i, true))
+                continue;
+            if (balls.isJumping[i])
+                launchBall(sim, i);
+            for (size_t child = firstSpawned; child < balls.size(); ++child)
+                launchBall(sim, child);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+const char *profilePhaseName(ProfilePhase phase)
+{
+    switch (phase)
+    {
+    case ProfilePhase::Events:
+        return "events";
+    case ProfilePhase::Snapshot:
+        return "snapshot";
+    case ProfilePhase::Histogram:
+        return "histogram";
+    case ProfilePhase::Draw:
+        return "draw";
+    case ProfilePhase::Balls:
+        return "balls";
+    case ProfilePhase::Capture:
+        return "capture";
+    case ProfilePhase::Display:
+        return "display";
+    case ProfilePhase::Simulation:
+        return "simulation";
+    default:
+        return "";
+    }
+}
+
+bool startFrameProfiler(FrameProfiler &profiler, const std::string &csvPath)
+{
+    profiler.scratch.reserve(PROFILE_WINDOW);
+    if (csvPath.empty())
+        return true;
+
+    profiler.csv.open(csvPath);
+    if (!profiler.csv)
+        return false;
+    profiler.csv << "frame";
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase)
+        profiler.csv << "," << profilePhaseName(static_cast<ProfilePhase>(phase)) << "_ms";
+    profiler.csv << ",draw_calls,allocations\n";
+    return true;
+}
+
+void finishProfileFrame(FrameProfiler &profiler, std::uint64_t allocations)
+{
+    ProfileFrame frame{};
+    frame.drawCalls = profiler.drawCalls;
+    frame.allocations = allocations;
+
+    ProfileSample sample;
+    while (profiler.renderSamples.pop(sample))
+        frame.phaseMs[static_cast<int>(sample.phase)] += sample.milliseconds;
+    while (profiler.simulationSamples.pop(sample))
+        frame.phaseMs[static_cast<int>(sample.phase)] += sample.milliseconds;
+
+    // The stream's buffer turns the rows into a write every few hundred frames
+    if (profiler.csv.is_open())
+    {
+        profiler.csv << profiler.frameCount;
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase)
+            profiler.csv << "," << frame.phaseMs[phase];
+        profiler.csv << "," << frame.drawCalls << "," << frame.allocations << "\n";
+    }
+
+    profiler.recent[profiler.frameCount % PROFILE_WINDOW] = frame;
+    profiler.frameCount++;
+    profiler.drawCalls = 0;
+}
+
+void profilePercentiles(FrameProfiler &profiler, ProfilePhase phase, float percentiles[3])
+{
+    const std::uint64_t count = std::min<std::uint64_t>(profiler.frameCount, PROFILE_WINDOW);
+    std::vector<float> &values = profiler.scratch;
+    values.clear();
+    for (std::uint64_t f = profiler.frameCount - count; f < profiler.frameCount; ++f)
+        values.push_back(profiler.recent[f % PROFILE_WINDOW].phaseMs[static_cast<int>(phase)]);
+
+    const float ranks[3] = {0.50f, 0.95f, 0.99f};
+    for (int p = 0; p < 3; ++p)
+    {
+        if (values.empty())
+        {
+            percentiles[p] = 0.0f;
+            continue;
+        }
+        auto nth = values.begin() + static_cast<size_t>(ranks[p] * (values.size() - 1));
+        std::nth_element(values.begin(), nth, values.end());
+        percentiles[p] = *nth;
+    }
+}
+
+std::string formatProfileOverlay(FrameProfiler &profiler)
+{
+    std::string text = "phase        p50    p95    p99 ms\n";
+    char line[64];
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase)
+    {
+        float percentiles[3];
+        profilePercentiles(profiler, static_cast<ProfilePhase>(phase), percentiles);
+        std::snprintf(line, sizeof(line), "%-10s %6.2f %6.2f %6.2f\n", profilePhaseName(static_cast<ProfilePhase>(phase)),
+                      percentiles[0], percentiles[1], percentiles[2]);
+        text += line;
+    }
+    if (profiler.frameCount > 0)
+    {
+        const ProfileFrame &last = profiler.recent[(profiler.frameCount - 1) % PROFILE_WINDOW];
+        std::snprintf(line, sizeof(line), "draw calls %d, allocations %llu per frame", last.drawCalls,
+                      static_cast<unsigned long long>(last.allocations));
+        text += line;
+    }
+    std::uint64_t dropped = profiler.renderSamples.dropped.load() + profiler.simulationSamples.dropped.load();
+    if (dropped > 0)
+        text += "\ndropped samples " + std::to_string(dropped);
+    return text;
+}
+
+bool closeProfileCsv(FrameProfiler &profiler)
+{
+    profiler.csv.close();
+    return !profiler.csv.fail();
+}
@@ -0,0 +1,692 @@
+#include "simulation.hpp"
+#include "checkpoint.hpp"
+#include "physics.hpp"
+#include <limits>
+
+void initSimulation(Simulation &sim, int boxCount, float multiplicativeFactor, std::uint32_t seed)
+{
+    sim.layout = makeBoxLayout(boxCount);
+    createHistogramModel(sim.bins, boxCount);
+    sim.visits.assign(boxCount, 0);
+    sim.cascadePopulation.assign(boxCount, 0);
+    sim.cascadeVisits.assign(boxCount, 0);
+    sim.cycleVisits.assign(boxCount, 0);
+    sim.multiplicativeFactor = multiplicativeFactor;
+    sim.process = makeUniformProcess(boxCount);
+    sim.seed = seed;
+    sim.rng.seed(seed);
+    sim.jumpKernel = selectJumpKernel();
+    sim.balls.reserve(sim.maxAnimatedBalls * 4);
+    sim.balls.spawn(sim.layout.restPosition(0), 0, sim.simTime);
+}
+
+void logTransition(Simulation &sim, std::uint32_t ball, int fromBox, int toBox, int splitCount, bool first)
+{
+    if (sim.eventLog)
+        logEvent(*sim.eventLog, makeTransitionRecord(sim.cycleCount, ball, fromBox, toBox, splitCount, first));
+}
+
+std::uint64_t replayKey(std::uint32_t ball, int box)
+{
+    return (static_cast<std::uint64_t>(ball) << 32) | static_cast<std::uint32_t>(box);
+}
+
+void loadReplayCycle(Simulation &sim)
+{
+    ReplayState &replay = sim.replay;
+    const EventLogReader &log = *replay.log;
+    replay.events.clear();
+    replay.bulkVisits.clear();
+
+    bool started = false;
+    while (replay.cursor < log.count)
+    {
+        const TransitionRecord &record = log.records[replay.cursor];
+        if (record.ball == RESET_BALL)
+        {
+            if (started)
+                break;
+            sim.multiplicativeFactor = resetFactor(record);
+            std::fill(sim.visits.begin(), sim.visits.end(), 0);
+            std::fill(sim.bins.binVisits.begin(), sim.bins.binVisits.end(), 0);
+            sim.stepCount = 0;
+            sim.converged = false;
+            refreshConvergence(sim);
+            replay.cursor++;
+            continue;
+        }
+        if (!started)
+        {
+            sim.cycleCount = static_cast<int>(record.cycle);
+            started = true;
+        }
+        else if (record.cycle != static_cast<std::uint32_t>(sim.cycleCount))
+            break;
+
+        if (record.ball == BULK_VISITS_BALL)
+            replay.bulkVisits.push_back(replay.cursor);
+        else if (record.isFirst())
+            replay.events[replayKey(record.ball, record.fromBox)] = replay.cursor;
+        replay.cursor++;
+    }
+
+    if (!started && !replay.finished)
+    {
+        replay.finished = true;
+        sim.isPaused = true;
+        std::cout << "Replay finished\n";
+    }
+}
+
+void startReplay(Simulation &sim, const EventLogReader &log)
+{
+    sim.replay.log = &log;
+    sim.replay.cursor = 0;
+    sim.multiplicativeFactor = log.header->multiplicativeFactor;
+    loadReplayCycle(sim);
+}
+
+const TransitionRecord *findReplayEvent(const ReplayState &replay, std::uint32_t ball, int box)
+{
+    auto found = replay.events.find(replayKey(ball, box));
+    if (found == replay.events.end())
+        return nullptr;
+    return &replay.log->records[found->second];
+}
+
+void countVisits(Simulation &sim, int box, std::uint64_t count)
+{
+    sim.visits[box] += count;
+    int bin = sim.bins.binOfBox[box];
+    if (bin >= 0)
+        sim.bins.binVisits[bin] += count;
+    if (sim.convergence.valid)
+        addConvergenceVisits(sim.convergence, box, sim.visits[box] - count, count);
+    if (sim.cycleStats && count > 0)
+    {
+        if (sim.cycleVisits[box] == 0)
+            sim.cycleBoxes.push_back(box);
+        sim.cycleVisits[box] += count;
+    }
+}
+
+void refreshConvergence(Simulation &sim)
+{
+    sim.convergence.valid = false;
+    if (!sim.trackConvergence)
+        return;
+    if (!resetConvergence(sim.convergence, sim.process, sim.multiplicativeFactor, sim.bins.binOfBox, sim.bins.binCount(), sim.visits))
+        std::cout << "No finite exact distribution for factor " << sim.multiplicativeFactor << "\n";
+}
+
+void checkConvergence(Simulation &sim)
+{
+    if (!sim.convergence.valid || sim.converged || (sim.targetKl <= 0.0 && sim.targetL1 <= 0.0) ||
+        sim.cycleCount + 1 < CONVERGENCE_MIN_CYCLES)
+        return;
+
+    double kl = klDivergence(sim.convergence);
+    double l1 = l1Distance(sim.convergence, sim.bins.binVisits);
+    if ((sim.targetKl > 0.0 && kl > sim.targetKl) || (sim.targetL1 > 0.0 && l1 > sim.targetL1))
+        return;
+    sim.converged = true;
+    sim.isPaused = true;
+    std::cout << "Converged after " << sim.cycleCount + 1 << " cycles: KL " << kl << ", L1 " << l1 << "\n";
+}
+
+void recordCycleStats(Simulation &sim, std::uint32_t flags)
+{
+    if (!sim.cycleStats)
+        return;
+
+    CycleStatsRecord record{};
+    record.cycle = static_cast<std::uint32_t>(sim.cycleCount);
+    record.steps = sim.stepCount - sim.cycleStartSteps;
+    record.totalSteps = sim.stepCount;
+    record.peakBalls = std::max(sim.cyclePeakBalls, sim.balls.size());
+    record.cascadeBalls = sim.cycleCascadeBalls;
+    record.duration = sim.simTime - sim.cycleStartTime;
+    record.multiplicativeFactor = sim.multiplicativeFactor;
+    record.flags = flags;
+    writeCycleStats(*sim.cycleStats, record, sim.cycleBoxes, sim.cycleVisits);
+
+    for (int box : sim.cycleBoxes)
+        sim.cycleVisits[box] = 0;
+    sim.cycleBoxes.clear();
+    sim.cycleStartSteps = sim.stepCount;
+    sim.cyclePeakBalls = 0;
+    sim.cycleCascadeBalls = 0;
+}
+
+void resetSimulation(Simulation &sim)
+{
+    if (sim.eventLog)
+        logReset(*sim.eventLog, sim.cycleCount, sim.multiplicativeFactor);
+    recordCycleStats(sim, CYCLE_STATS_PARTIAL | CYCLE_STATS_RESET);
+
+    // Reset all visit counts
+    std::fill(sim.visits.begin(), sim.visits.end(), 0);
+    std::fill(sim.bins.binVisits.begin(), sim.bins.binVisits.end(), 0);
+    sim.converged = false;
+    refreshConvergence(sim);
+
+    // Clear all balls and create initial ball
+    releaseBodies(sim, 0);
+    sim.balls.clear();
+    sim.balls.spawn(sim.layout.restPosition(0), 0, sim.simTime);
+    sim.nextBallId = 1;
+
+    // Reset counters
+    sim.stepCount = 0;
+    sim.cycleStartSteps = 0;
+    sim.cycleCascadeBalls = 0;
+    sim.cycleCount = 0;
+    sim.cycleStartTime = sim.simTime;
+}
+
+void resizeSimulation(Simulation &sim, int boxCount)
+{
+    sim.layout = makeBoxLayout(boxCount);
+    createHistogramModel(sim.bins, boxCount);
+    sim.visits.assign(boxCount, 0);
+    sim.cascadePopulation.assign(boxCount, 0);
+    sim.cascadeVisits.assign(boxCount, 0);
+    sim.cycleVisits.assign(boxCount, 0);
+    if (sim.physics)
+        rebuildPhysics(*sim.physics, sim.layout);
+}
+
+void applyParameterChanges(Simulation &sim)
+{
+    ParameterChanges changes = sim.pendingChanges;
+    sim.pendingChanges = ParameterChanges();
+    if (changes.setSeed)
+    {
+        sim.seed = changes.seed;
+        sim.rng.seed(changes.seed);
+        std::cout << "Seed " << changes.seed << "\n";
+    }
+    if (changes.multiplicativeFactor <= 0.0f && changes.boxCount <= 0)
+        return;
+
+    // Noise can make the pair end no cycles even if each change alone was fine
+    SsrProcess process;
+    if (changes.boxCount > 0)
+    {
+        std::vector<double> prior;
+        if (sim.priorPower != 0.0)
+            prior = powerPrior(changes.boxCount - 1, sim.priorPower);
+        if (!makeProcess(process, changes.boxCount, prior, sim.process.noise))
+        {
+            std::cout << "The prior has no valid weights for " << changes.boxCount - 1 << " states, keeping the old settings\n";
+            return;
+        }
+    }
+    float factor = changes.multiplicativeFactor > 0.0f ? changes.multiplicativeFactor : sim.multiplicativeFactor;
+    if (!cycleTerminates(changes.boxCount > 0 ? process : sim.process, factor))
+    {
+        std::cout << "Factor " << factor << " with noise " << sim.process.noise << " would never end a cycle, keeping the old settings\n";
+        return;
+    }
+
+    if (changes.boxCount > 0)
+    {
+        resizeSimulation(sim, changes.boxCount);
+        sim.process = std::move(process);
+        std::cout << "States " << changes.boxCount - 1 << "\n";
+    }
+    if (changes.multiplicativeFactor > 0.0f)
+    {
+        sim.multiplicativeFactor = factor;
+        std::cout << "Factor " << factor << "\n";
+    }
+
+    // The finished cycle is already recorded, so the marker is an empty record
+    // that tells readers the counts start over under the new settings
+    if (sim.eventLog)
+        logReset(*sim.eventLog, sim.cycleCount, sim.multiplicativeFactor);
+    recordCycleStats(sim, CYCLE_STATS_RESET);
+    std::fill(sim.visits.begin(), sim.visits.end(), 0);
+    std::fill(sim.bins.binVisits.begin(), sim.bins.binVisits.end(), 0);
+    sim.stepCount = 0;
+    sim.cycleStartSteps = 0;
+    sim.converged = false;
+    refreshConvergence(sim);
+}
+
+void startNewCycle(Simulation &sim)
+{
+    // Visits of balls the recorded run counted rather than animated
+    if (sim.replay.log)
+    {
+        for (size_t index : sim.replay.bulkVisits)
+        {
+            const TransitionRecord &record = sim.replay.log->records[index];
+            countVisits(sim, record.fromBox, record.toBox);
+            sim.stepCount += record.toBox;
+        }
+    }
+    if (sim.cycleCascadeBalls > 0 && !sim.turbo)
+        std::cout << "Cycle " << sim.cycleCount << " moved " << sim.cycleCascadeBalls << " balls to the count-based cascade\n";
+    recordCycleStats(sim, 0);
+    sim.cycleCascadeBalls = 0;
+    checkConvergence(sim);
+
+    // Clear all balls and create new initial ball
+    releaseBodies(sim, 0);
+    sim.balls.clear();
+    applyParameterChanges(sim);
+    sim.balls.spawn(sim.layout.restPosition(0), 0, sim.simTime);
+    sim.nextBallId = 1;
+    sim.cycleCount++;
+    sim.cycleStartTime = sim.simTime;
+    if (sim.replay.log)
+        loadReplayCycle(sim);
+
+    // std::cout << "Starting cycle " << cycleCount << std::endl;
+}
+
+void virtualizeBalls(Simulation &sim)
+{
+    BallStore &balls = sim.balls;
+    for (size_t i = sim.maxAnimatedBalls; i < balls.size(); ++i)
+    {
+        if (balls.hasReachedEnd[i])
+            continue;
+        // The box a ball is waiting on or heading to has not been counted yet
+        sim.cascadePopulation[balls.isJumping[i] ? balls.nextBox[i] : balls.currentBox[i]]++;
+        sim.cycleCascadeBalls++;
+    }
+    releaseBodies(sim, sim.maxAnimatedBalls);
+    balls.truncate(sim.maxAnimatedBalls);
+
+    sim.stepCount += runCascade(sim.cascadePopulation, sim.cascadeVisits, sim.process, sim.multiplicativeFactor, sim.rng);
+    for (int box = 0; box < sim.cascadeVisits.size(); ++box)
+    {
+        if (sim.cascadeVisits[box] == 0)
+            continue;
+        countVisits(sim, box, sim.cascadeVisits[box]);
+        if (sim.eventLog)
+            logBulkVisits(*sim.eventLog, sim.cycleCount, box, sim.cascadeVisits[box]);
+        sim.cascadeVisits[box] = 0;
+    }
+}
+
+bool leaveBox(Simulation &sim, size_t i, bool animate)
+{
+    BallStore &balls = sim.balls;
+    const int boxCount = sim.layout.boxCount;
+    int box = balls.currentBox[i];
+    std::uint32_t ballId = balls.id[i];
+
+    // A replayed ball without a recorded move was counted by the cascade in the
+    // recorded run; its visits arrive with the cycle's bulk records
+    const TransitionRecord *recorded = nullptr;
+    if (sim.replay.log)
+    {
+        recorded = findReplayEvent(sim.replay, ballId, box);
+        if (!recorded)
+        {
+            balls.swapRemove(i);
+            return false;
+        }
+    }
+
+    if (box > 0)
+    {
+        countVisits(sim, box, 1);
+        sim.stepCount++;
+    }
+
+    if (box == boxCount - 1)
+    {
+        // Ball reached the end
+        balls.hasReachedEnd[i] = 1;
+        logTransition(sim, ballId, box, box, 0, true);
+        return true;
+    }
+
+    // Split the ball based on multiplicative factor
+    sf::Vector2f parentPos = balls.position[i];
+    size_t firstSpawned = balls.size();
+    int totalBalls = recorded ? recorded->splitCount() : splitCount(sim.multiplicativeFactor, sim.rng);
+    int children = splitBall(balls, i, totalBalls, sim.multiplicativeFactor, sim.rng);
+    if (children == 0)
+    {
+        logTransition(sim, ballId, box, box, 0, true);
+        balls.swapRemove(i);
+        return false;
+    }
+
+    // Setup jump for each new ball
+    for (int c = 0; c < children; ++c)
+    {
+        size_t child = (c == 0) ? i : firstSpawned + c - 1;
+        int target;
+        if (recorded)
+        {
+            target = recorded[c].destination();
+            balls.id[child] = recorded[c].ball;
+        }
+        else
+        {
+            target = sampleTarget(sim.process, box, sim.rng);
+            balls.id[child] = (c == 0) ? ballId : sim.nextBallId++;
+        }
+        logTransition(sim, balls.id[child], box, target, children, c == 0);
+        balls.setJump(child, parentPos, target, sim.layout.restPosition(target));
+        if (animate)
+        {
+            balls.isJumping[child] = 1;
+            balls.jumpProgress[child] = 0.0f;
+        }
+        else
+        {
+            balls.position[child] = balls.target(child);
+            balls.currentBox[child] = target;
+            balls.isJumping[child] = 0;
+            balls.restStart[child] = sim.simTime;
+        }
+    }
+    return true;
+}
+
+void releaseBodies(Simulation &sim, size_t first)
+{
+    if (sim.physics)
+        releaseBallBodies(*sim.physics, sim.balls, first);
+}
+
+void stepSimulation(Simulation &sim, float dt)
+{
+    if (sim.isPaused)
+        return;
+
+    BallStore &balls = sim.balls;
+    const float simDt = dt * sim.simulationSpeed;
+    sim.simTime += simDt;
+    sim.stepIndex++;
+
+    // If all balls have reached the end, wait and start new cycle
+    bool allBallsAtEnd = std::all_of(balls.hasReachedEnd.begin(), balls.hasReachedEnd.end(),
+                                     [](std::uint8_t reached) { return reached != 0; });
+    if (allBallsAtEnd)
+    {
+        if (sim.simTime - sim.cycleStartTime > sim.cycleWaitTime)
+            startNewCycle(sim);
+        return;
+    }
+
+    // Trail points are taken before anything moves
+    const size_t count = balls.size();
+    if (sim.recordTrails && sim.stepIndex % TRAIL_SAMPLE_STEPS == 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+            balls.pushTrail(i, balls.position[i]);
+    }
+
+    // Physics mode flies the jumps in Box2D instead of along the animated arcs
+    if (sim.physics)
+    {
+        stepPhysics(sim, simDt);
+    }
+    else
+    {
+        // Every jump advances in one vectorized pass that flags the balls that landed
+        sim.jumpLanded.resize(count);
+        JumpBatch batch;
+        batch.count = count;
+        batch.isJumping = balls.isJumping.data();
+        batch.progress = balls.jumpProgress.data();
+        batch.startX = balls.startX.data();
+        batch.startY = balls.startY.data();
+        batch.targetX = balls.targetX.data();
+        batch.targetY = balls.targetY.data();
+        batch.position = reinterpret_cast<float *>(balls.position.data());
+        batch.landed = sim.jumpLanded.data();
+        advanceJumps(batch, simDt / sim.jumpDurationBase, sim.jumpKernel);
+
+        // Discrete SSR steps. Walking backwards means a swap-removed slot is refilled
+        // by a ball that was already processed, and children appended by splitBall
+        // are not advanced until the next step.
+        for (size_t i = count; i-- > 0;)
+        {
+            if (sim.jumpLanded[i])
+            {
+                balls.position[i] = balls.target(i);
+                balls.currentBox[i] = balls.nextBox[i];
+                balls.isJumping[i] = 0;
+                balls.restStart[i] = sim.simTime;
+            }
+            else if (!balls.hasReachedEnd[i] && !balls.isJumping[i] && sim.simTime - balls.restStart[i] > sim.waitTime)
+            {
+                leaveBox(sim, i, true);
+            }
+        }
+    }
+
+    // Keep at most maxAnimatedBalls on screen; the rest continue as counts.
+    // Replay drops those balls itself when their recorded moves run out.
+    sim.cyclePeakBalls = std::max(sim.cyclePeakBalls, balls.size());
+    if (balls.size() > sim.maxAnimatedBalls && !sim.replay.log)
+        virtualizeBalls(sim);
+}
+
+void stepTurbo(Simulation &sim, float dt)
+{
+    if (sim.isPaused)
+        return;
+
+    BallStore &balls = sim.balls;
+    sim.simTime += dt * sim.simulationSpeed;
+    sim.stepIndex++;
+
+    int budget = TURBO_STEPS_PER_TICK;
+    while (budget > 0)
+    {
+        bool allBallsAtEnd = std::all_of(balls.hasReachedEnd.begin(), balls.hasReachedEnd.end(),
+                                         [](std::uint8_t reached) { return reached != 0; });
+        if (allBallsAtEnd)
+        {
+            startNewCycle(sim);
+            if (sim.isPaused)
+                break; // the replay ran out
+            continue;
+        }
+
+        // One discrete step for every ball still in play, backwards as in stepSimulation
+        for (size_t i = balls.size(); i-- > 0;)
+        {
+            if (balls.hasReachedEnd[i])
+                continue;
+            leaveBox(sim, i, false);
+            budget--;
+        }
+
+        sim.cyclePeakBalls = std::max(sim.cyclePeakBalls, balls.size());
+        if (balls.size() > sim.maxAnimatedBalls && !sim.replay.log)
+            virtualizeBalls(sim);
+    }
+}
+
+void settleBalls(Simulation &sim)
+{
+    BallStore &balls = sim.balls;
+    for (size_t i = 0; i < balls.size(); ++i)
+    {
+        if (balls.isJumping[i])
+        {
+            balls.position[i] = balls.target(i);
+            balls.currentBox[i] = balls.nextBox[i];
+            balls.isJumping[i] = 0;
+            balls.jumpProgress[i] = 1.0f;
+        }
+        balls.restStart[i] = sim.simTime;
+        balls.clearTrail(i);
+    }
+    releaseBodies(sim, 0);
+}
+
+void pushCommand(Simulation &sim, SimulationCommandType type, double value)
+{
+    std::lock_guard<std::mutex> lock(sim.commandMutex);
+    sim.commands.push_back(SimulationCommand{type, value});
+}
+
+bool applyCommands(Simulation &sim)
+{
+    {
+        std::lock_guard<std::mutex> lock(sim.commandMutex);
+        sim.pendingCommands.swap(sim.commands);
+    }
+    if (sim.pendingCommands.empty())
+        return false;
+
+    for (const SimulationCommand &command : sim.pendingCommands)
+    {
+        // A replay follows the recorded run, including its resets
+        if (sim.replay.log && (command.type == SimulationCommandType::Reset || command.type == SimulationCommandType::SetFactor ||
+                               command.type == SimulationCommandType::SetStates || command.type == SimulationCommandType::SetSeed))
+        {
+            std::cout << "Reset and parameter changes are disabled during replay\n";
+            continue;
+        }
+
+        switch (command.type)
+        {
+        case SimulationCommandType::Reset:
+            resetSimulation(sim);
+            std::cout << "Simulation reset\n";
+            break;
+        case SimulationCommandType::SetFactor:
+            if (!cycleTerminates(sim.process, static_cast<float>(command.value)))
+            {
+                std::cout << "Factor " << command.value << " is too large for noise " << sim.process.noise
+                          << ": cycles would never end\n";
+                break;
+            }
+            sim.pendingChanges.multiplicativeFactor = static_cast<float>(command.value);
+            std::cout << "Factor " << command.value << " from the next cycle\n";
+            break;
+        case SimulationCommandType::SetStates:
+            if (sim.fixedStateCount || sim.eventLog || sim.cycleStats)
+                std::cout << "The state count is fixed by the prior file or the recorded output\n";
+            else if (sim.physics && command.value + 1 > PHYSICS_MAX_BOX_COUNT)
+                std::cout << "Physics mode needs at most " << PHYSICS_MAX_BOX_COUNT - 1 << " states\n";
+            else
+            {
+                sim.pendingChanges.boxCount = static_cast<int>(command.value) + 1;
+                std::cout << "States " << command.value << " from the next cycle\n";
+            }
+            break;
+        case SimulationCommandType::SetSeed:
+            if (!(command.value >= 0.0 && command.value <= std::numeric_limits<std::uint32_t>::max()))
+            {
+                std::cout << "Seed " << command.value << " is not a 32-bit seed\n";
+                break;
+            }
+            sim.pendingChanges.setSeed = true;
+            sim.pendingChanges.seed = static_cast<std::uint32_t>(command.value);
+            break;
+        case SimulationCommandType::ChangeSpeed:
+            sim.simulationSpeed = std::min(std::max(sim.simulationSpeed + static_cast<float>(command.value), MIN_SPEED), MAX_SPEED);
+            std::cout << "Speed " << (command.value > 0 ? "increased" : "decreased") << " to " << sim.simulationSpeed << "x\n";
+            break;
+        case SimulationCommandType::SetSpeed:
+            sim.simulationSpeed = std::min(std::max(static_cast<float>(command.value), MIN_SPEED), MAX_SPEED);
+            std::cout << "Speed " << sim.simulationSpeed << "x\n";
+            break;
+        case SimulationCommandType::TogglePause:
+            sim.isPaused = !sim.isPaused;
+            std::cout << (sim.isPaused ? "Simulation paused\n" : "Simulation resumed\n");
+            break;
+        case SimulationCommandType::ToggleTurbo:
+            sim.turbo = !sim.turbo;
+            settleBalls(sim);
+            std::cout << (sim.turbo ? "Turbo mode on\n" : "Turbo mode off\n");
+            break;
+        case SimulationCommandType::SetTrails:
+            sim.recordTrails = command.value != 0.0f;
+            for (size_t i = 0; i < sim.balls.size() && !sim.recordTrails; ++i)
+                sim.balls.clearTrail(i);
+            break;
+        case SimulationCommandType::SetConvergence:
+            sim.trackConvergence = command.value != 0.0f;
+            refreshConvergence(sim);
+            break;
+        }
+    }
+    sim.pendingCommands.clear();
+    return true;
+}
+
+void publishSnapshot(Simulation &sim)
+{
+    RenderSnapshot &snapshot = sim.snapshots.writeBuffer();
+    snapshot.position = sim.balls.position;
+    snapshot.color = sim.balls.color;
+    // Without trails every trailSize is 0 and the points are never read
+    if (sim.recordTrails)
+        snapshot.trail = sim.balls.trail;
+    else
+        snapshot.trail.clear();
+    snapshot.trailHead = sim.balls.trailHead;
+    snapshot.trailSize = sim.balls.trailSize;
+    snapshot.binVisits = sim.bins.binVisits;
+    if (sim.convergence.valid)
+    {
+        if (sim.convergence.updates > CONVERGENCE_RESYNC_UPDATES)
+            resyncConvergence(sim.convergence, sim.visits);
+        snapshot.exactBinShare = sim.convergence.binShare;
+        snapshot.klDivergence = klDivergence(sim.convergence);
+        snapshot.l1Distance = l1Distance(sim.convergence, sim.bins.binVisits);
+    }
+    else
+        snapshot.exactBinShare.clear();
+    snapshot.boxCount = sim.layout.boxCount;
+    snapshot.seed = sim.seed;
+    snapshot.stepCount = sim.stepCount;
+    snapshot.cycleCount = sim.cycleCount;
+    snapshot.multiplicativeFactor = sim.multiplicativeFactor;
+    snapshot.simulationSpeed = sim.simulationSpeed;
+    snapshot.isPaused = sim.isPaused;
+    snapshot.turbo = sim.turbo;
+    sim.snapshots.publish();
+}
+
+void runSimulation(Simulation &sim)
+{
+    using clock = std::chrono::steady_clock;
+    auto last = clock::now();
+    float accumulator = 0.0f;
+    publishSnapshot(sim);
+
+    while (sim.running.load(std::memory_order_relaxed))
+    {
+        bool changed = applyCommands(sim);
+
+        auto now = clock::now();
+        accumulator += std::chrono::duration<float>(now - last).count();
+        last = now;
+        accumulator = std::min(accumulator, MAX_STEP_BACKLOG);
+
+        {
+            ScopedTimer timer(sim.profileSamples, ProfilePhase::Simulation);
+            while (accumulator >= FIXED_TIMESTEP)
+            {
+                if (sim.turbo)
+                    stepTurbo(sim, FIXED_TIMESTEP);
+                else
+                    stepSimulation(sim, FIXED_TIMESTEP);
+                accumulator -= FIXED_TIMESTEP;
+                changed = changed || !sim.isPaused;
+            }
+            if (changed)
+                publishSnapshot(sim);
+            if (sim.checkpoint && !sim.replay.log)
+                checkpointIfDue(*sim.checkpoint, sim);
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<float>(FIXED_TIMESTEP - accumulator));
+    }
+}
@@ -0,0 +1,128 @@
+#include "simulation_view.hpp"
+
+bool createSimulationView(SimulationView &view, const GlyphAtlas &atlas, int boxCount, float multiplicativeFactor,
+                          unsigned densityThreads)
+{
+    Hud &hud = view.hud;
+    createHud(hud, atlas);
+
+    view.yAxisLabel = addHudLabel(hud, 10, sf::Color::White, sf::Vector2f(5, 120), 8);
+    hud.labels[view.yAxisLabel].rotation = -90;
+    setHudText(hud, view.yAxisLabel, "Count");
+
+    // Centered under the histogram
+    view.xAxisLabel = addHudLabel(hud, 10, sf::Color::White, sf::Vector2f(HIST_X + HIST_WIDTH / 2, 240), 40);
+    hud.labels[view.xAxisLabel].centered = true;
+
+    // Add labels in top right
+    view.stateCountLabel = addHudLabel(hud, 16, sf::Color::White, sf::Vector2f(WINDOW_WIDTH - 160, 20), 24);
+    view.stepCountLabel = addHudLabel(hud, 16, sf::Color(200, 255, 200), sf::Vector2f(WINDOW_WIDTH - 160, 42), 32);
+    view.ballCountLabel = addHudLabel(hud, 16, sf::Color(255, 200, 200), sf::Vector2f(WINDOW_WIDTH - 160, 64), 32);
+    view.factorLabel = addHudLabel(hud, 16, sf::Color(200, 200, 255), sf::Vector2f(WINDOW_WIDTH - 160, 86), 16);
+    view.cycleCountLabel = addHudLabel(hud, 16, sf::Color(255, 255, 200), sf::Vector2f(WINDOW_WIDTH - 160, 108), 24);
+    view.seedLabel = addHudLabel(hud, 16, sf::Color(180, 180, 180), sf::Vector2f(WINDOW_WIDTH - 160, 130), 24);
+    setHudText(hud, view.stepCountLabel, "Steps: 0");
+    setHudText(hud, view.ballCountLabel, "Balls: 1");
+    setHudFixed(hud, view.factorLabel, "Factor: ", multiplicativeFactor, 2);
+    setHudText(hud, view.cycleCountLabel, "Cycles: 0");
+
+    view.speedLabel = addHudLabel(hud, 13, sf::Color(255, 215, 0), sf::Vector2f(WINDOW_WIDTH - 400, 264), 16);
+    view.pauseLabel = addHudLabel(hud, 13, sf::Color(255, 100, 100), sf::Vector2f(WINDOW_WIDTH - 400, 280), 8);
+    view.convergenceLabel = addHudLabel(hud, 13, sf::Color(255, 140, 0), sf::Vector2f(WINDOW_WIDTH - 400, 312), 40);
+    setHudText(hud, view.speedLabel, "Speed: 1.0x");
+
+    view.histogramLabels = hud.labels.size();
+    setViewBoxCount(view, boxCount);
+
+    return view.ballRenderer.create() && createDensityRenderer(view.densityRenderer, densityThreads);
+}
+
+void setViewBoxCount(SimulationView &view, int boxCount)
+{
+    view.shownBoxCount = boxCount;
+    createDescendingEdges(view.stairs, makeBoxLayout(boxCount));
+    removeHudLabels(view.hud, view.histogramLabels);
+    createHistogramModel(view.histModel, boxCount);
+    createHistogram(view.histogram, view.histogramBars, view.histModel, view.hud);
+    setHudText(view.hud, view.xAxisLabel, view.histModel.logBinned ? "State (log bins, mean count per state)" : "State");
+    setHudCount(view.hud, view.stateCountLabel, "States: ", boxCount - 1);
+}
+
+void syncSimulationView(SimulationView &view, const RenderSnapshot &snapshot)
+{
+    Hud &hud = view.hud;
+
+    // A new state count from the editor arrives with the first snapshot of its cycle
+    if (snapshot.boxCount != view.shownBoxCount)
+        setViewBoxCount(view, snapshot.boxCount);
+    syncHistogramModel(view.histModel, snapshot.binVisits);
+
+    // Labels whose value is unchanged keep their geometry
+    setHudCount(hud, view.stepCountLabel, "Steps: ", snapshot.stepCount);
+    setHudCount(hud, view.ballCountLabel, "Balls: ", snapshot.ballCount());
+    setHudCount(hud, view.cycleCountLabel, "Cycles: ", snapshot.cycleCount);
+    setHudFixed(hud, view.factorLabel, "Factor: ", snapshot.multiplicativeFactor, 2);
+    setHudCount(hud, view.seedLabel, "Seed: ", snapshot.seed);
+    if (snapshot.turbo)
+        setHudText(hud, view.speedLabel, "Speed: TURBO");
+    else
+        setHudFixed(hud, view.speedLabel, "Speed: ", snapshot.simulationSpeed, 1, "x");
+    setHudText(hud, view.pauseLabel, snapshot.isPaused ? "PAUSED" : "");
+
+    // The overlay follows the bar scale, so it is laid out after the sync
+    layoutExactOverlay(view.exactOverlay, view.histModel, snapshot.exactBinShare);
+    if (snapshot.exactBinShare.empty())
+        setHudText(hud, view.convergenceLabel, "");
+    else
+    {
+        char buffer[HUD_NUMBER_CHARS];
+        char *last = buffer + sizeof(buffer);
+        char *end = formatScientific(appendText(buffer, last, "Exact: KL "), last, snapshot.klDivergence, 2);
+        end = formatScientific(appendText(end, last, "  L1 "), last, snapshot.l1Distance, 2);
+        setHudText(hud, view.convergenceLabel, buffer, end);
+    }
+}
+
+void updateSimulationView(SimulationView &view)
+{
+    updateHistogram(view.histogram, view.histogramBars, view.histModel, view.hud);
+    updateHud(view.hud);
+}
+
+int drawSimulationScene(const SimulationView &view, sf::RenderTarget &target)
+{
+    target.draw(view.histogramBars);
+    int calls = 1;
+    if (view.exactOverlay.getVertexCount() > 0)
+    {
+        target.draw(view.exactOverlay);
+        calls++;
+    }
+    calls += drawHud(view.hud, target);
+    target.draw(view.stairs);
+    return calls + 1;
+}
+
+void drawSimulationBalls(SimulationView &view, Simulation &sim, sf::RenderTarget &target, bool heatmapRequested,
+                         float frameSeconds)
+{
+    const RenderSnapshot &latest = sim.snapshots.readBuffer();
+    bool heatmap = heatmapRequested || latest.ballCount() > DENSITY_AUTO_BALLS;
+    if (heatmap != view.showHeatmap)
+    {
+        // Trails are only recorded while balls are drawn one by one
+        view.showHeatmap = heatmap;
+        clearDensity(view.densityRenderer);
+        pushCommand(sim, SimulationCommandType::SetTrails, view.showHeatmap ? 0.0f : 1.0f);
+    }
+    if (view.showHeatmap)
+    {
+        accumulateDensity(view.densityRenderer, latest, frameSeconds);
+        drawDensity(view.densityRenderer, target);
+    }
+    else
+    {
+        view.ballRenderer.build(latest);
+        view.ballRenderer.draw(target);
+    }
+}
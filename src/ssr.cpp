@@ -0,0 +1,320 @@
+#include "ssr.hpp"
+#include <iostream>
+#include <cmath>
+
+BoxLayout makeBoxLayout(int boxCount)
+{
+    BoxLayout layout;
+    layout.boxCount = boxCount;
+    // Keep the 2 px gaps only while boxes are wide enough to show them
+    float gapPixels = (WINDOW_WIDTH / boxCount >= 6) ? 2.f : 0.f;
+    layout.gap = gapPixels / SCALE;
+    layout.boxWidth = (WINDOW_WIDTH - (boxCount + 1) * gapPixels) / SCALE / boxCount;
+    layout.stepHeight = STAIR_HEIGHT / boxCount;
+    return layout;
+}
+
+void appendRect(sf::VertexArray &vertices, float left, float top, float width, float height, sf::Color color)
+{
+    vertices.append(sf::Vertex(sf::Vector2f(left, top), color));
+    vertices.append(sf::Vertex(sf::Vector2f(left + width, top), color));
+    vertices.append(sf::Vertex(sf::Vector2f(left + width, top + height), color));
+    vertices.append(sf::Vertex(sf::Vector2f(left, top), color));
+    vertices.append(sf::Vertex(sf::Vector2f(left + width, top + height), color));
+    vertices.append(sf::Vertex(sf::Vector2f(left, top + height), color));
+}
+
+void createDescendingEdges(sf::VertexArray &stairs, const BoxLayout &layout)
+{
+    stairs.clear();
+    stairs.setPrimitiveType(sf::Triangles);
+    const float outline = 2.f;
+    const float boxPixels = layout.boxWidth * SCALE;
+
+    if (boxPixels >= 4.f)
+    {
+        for (int i = 0; i < layout.boxCount; ++i)
+        {
+            float left = layout.x(i) * SCALE;
+            float height = layout.height(i) * SCALE;
+            float top = WINDOW_HEIGHT - height;
+            appendRect(stairs, left - outline, top - outline, boxPixels + 2 * outline, height + 2 * outline, sf::Color::Red);
+            appendRect(stairs, left, top, boxPixels, height, sf::Color::White);
+        }
+        return;
+    }
+
+    for (int column = 0; column < WINDOW_WIDTH; ++column)
+    {
+        // The staircase descends, so the first box in a column is the tallest
+        int box = std::min(static_cast<int>(column / boxPixels), layout.boxCount - 1);
+        float height = layout.height(box) * SCALE;
+        float top = WINDOW_HEIGHT - height;
+        appendRect(stairs, static_cast<float>(column), top - 1.f, 1.f, 1.f, sf::Color::Red);
+        appendRect(stairs, static_cast<float>(column), top, 1.f, height, sf::Color::White);
+    }
+}
+
+void createHistogramModel(HistogramModel &model, int boxCount)
+{
+    const int states = boxCount - 1;
+    const int maxBins = static_cast<int>(HIST_WIDTH / MIN_BAR_WIDTH);
+
+    model.logBinned = states > maxBins;
+    model.binFirstState.clear();
+    model.binFirstState.push_back(1);
+    if (!model.logBinned)
+    {
+        for (int state = 2; state <= states + 1; ++state)
+            model.binFirstState.push_back(state);
+    }
+    else
+    {
+        // Geometric bin edges from state 1 to states + 1, at least one state wide
+        double ratio = std::pow(states + 1.0, 1.0 / maxBins);
+        double edge = 1.0;
+        int last = 1;
+        while (last < states + 1)
+        {
+            edge *= ratio;
+            int next = std::max(last + 1, std::min(states + 1, static_cast<int>(std::lround(edge))));
+            model.binFirstState.push_back(next);
+            last = next;
+        }
+    }
+
+    int bins = static_cast<int>(model.binFirstState.size()) - 1;
+    model.binOfBox.assign(boxCount, -1);
+    for (int bin = 0; bin < bins; ++bin)
+    {
+        for (int state = model.binFirstState[bin]; state < model.binFirstState[bin + 1]; ++state)
+            model.binOfBox[boxCount - state] = bin;
+    }
+    model.binVisits.assign(bins, 0);
+    model.dirty.assign(bins, 0);
+    model.dirtyBins.clear();
+    model.dirtyBins.reserve(bins);
+    model.maxValue = 1.0;
+    model.rescale = true;
+}
+
+void syncHistogramModel(HistogramModel &model, const std::vector<std::uint64_t> &binVisits)
+{
+    bool decreased = false;
+    for (int bin = 0; bin < model.binCount(); ++bin)
+    {
+        if (binVisits[bin] == model.binVisits[bin])
+            continue;
+        decreased = decreased || binVisits[bin] < model.binVisits[bin];
+        model.binVisits[bin] = binVisits[bin];
+
+        double value = model.binValue(bin);
+        if (value > model.maxValue)
+        {
+            model.maxValue = value;
+            model.rescale = true;
+        }
+        if (!model.dirty[bin])
+        {
+            model.dirty[bin] = 1;
+            model.dirtyBins.push_back(bin);
+        }
+    }
+
+    // Counts only go down on a reset, which needs a fresh max
+    if (decreased)
+    {
+        model.maxValue = 1.0;
+        for (int bin = 0; bin < model.binCount(); ++bin)
+            model.maxValue = std::max(model.maxValue, model.binValue(bin));
+        model.rescale = true;
+    }
+}
+
+float histogramBarHeight(const HistogramModel &model, double value)
+{
+    if (value <= 0.0)
+        return 0.0f;
+    if (!model.logBinned)
+        return static_cast<float>(value / model.maxValue) * HIST_HEIGHT;
+
+    // Log scale covering LOG_DECADES below the max
+    double decades = std::log10(value / model.maxValue) + LOG_DECADES;
+    return static_cast<float>(std::max(decades / LOG_DECADES, 0.0)) * HIST_HEIGHT;
+}
+
+bool isTickState(const HistogramModel &model, int state, int states)
+{
+    if (model.logBinned)
+    {
+        while (state % 10 == 0)
+            state /= 10;
+        return state == 1;
+    }
+
+    // Smallest step of the form 1, 2, 5 times a power of ten that keeps the labels readable
+    const int multiples[] = {1, 2, 5};
+    int step = 1;
+    for (int k = 1; states / step > LABELED_BAR_LIMIT / 2; ++k)
+        step = multiples[k % 3] * static_cast<int>(std::pow(10, k / 3));
+    return state == 1 || state % step == 0;
+}
+
+void createHistogram(std::vector<HistogramBar> &histogram, sf::VertexArray &bars, const HistogramModel &model, Hud &hud)
+{
+    const int bins = model.binCount();
+    const int states = model.binFirstState.back() - 1;
+    const float barWidth = HIST_WIDTH / bins;
+    const bool labelAll = bins <= LABELED_BAR_LIMIT;
+
+    histogram.clear();
+    histogram.reserve(bins);
+    for (int i = 0; i < bins; ++i)
+    {
+        HistogramBar histBar;
+        histBar.left = HIST_X + i * barWidth;
+        histBar.width = barWidth >= 4.0f ? barWidth - 2.0f : barWidth;
+        histBar.outlined = barWidth >= 4.0f;
+
+        // Display labels in ascending order (1, 2, 3, ...) from left to right.
+        // With many bars only the bar holding a tick state is labeled.
+        int labelState = 0;
+        for (int state = model.binFirstState[i]; state < model.binFirstState[i + 1]; ++state)
+        {
+            if (labelAll || isTickState(model, state, states))
+            {
+                labelState = state;
+                break;
+            }
+        }
+        // Center the label under each bar
+        const float centerX = HIST_X + i * barWidth + barWidth / 2;
+        if (labelState > 0)
+        {
+            histBar.label = addHudLabel(hud, 7, sf::Color::White, sf::Vector2f(centerX, HIST_Y + HIST_HEIGHT + 5), 8);
+            hud.labels[histBar.label].centered = true;
+            setHudCount(hud, histBar.label, "", labelState);
+        }
+        if (labelAll)
+        {
+            histBar.valueText = addHudLabel(hud, 7, sf::Color::White, sf::Vector2f(centerX, HIST_Y + HIST_HEIGHT), 20);
+            hud.labels[histBar.valueText].centered = true;
+            hud.labels[histBar.valueText].hidden = true;
+        }
+
+        histogram.push_back(histBar);
+    }
+    appendHistogramBars(bars, histogram);
+}
+
+void layoutHistogramBar(HistogramBar &histBar, float barHeight, Hud &hud)
+{
+    histBar.height = barHeight;
+    if (histBar.valueText < 0)
+        return;
+
+    // Center the value text above each bar, shown once the bar is tall enough
+    float top = HIST_Y + HIST_HEIGHT - barHeight;
+    float textY = top - 15;
+    if (textY < HIST_Y)
+        textY = top + 2;
+    setHudPosition(hud, histBar.valueText, sf::Vector2f(histBar.left + histBar.width / 2, textY));
+    setHudHidden(hud, histBar.valueText, barHeight <= 10);
+}
+
+void appendHistogramBars(sf::VertexArray &bars, const std::vector<HistogramBar> &histogram)
+{
+    bars.setPrimitiveType(sf::Triangles);
+    bars.clear();
+    const sf::Color fill(100, 150, 255, 180);
+    for (const HistogramBar &histBar : histogram)
+    {
+        float top = HIST_Y + HIST_HEIGHT - histBar.height;
+        if (histBar.outlined)
+        {
+            // Four sides rather than one rectangle under the fill, which is translucent
+            appendRect(bars, histBar.left - 1.0f, top - 1.0f, histBar.width + 2.0f, 1.0f, sf::Color::White);
+            appendRect(bars, histBar.left - 1.0f, top + histBar.height, histBar.width + 2.0f, 1.0f, sf::Color::White);
+            appendRect(bars, histBar.left - 1.0f, top, 1.0f, histBar.height, sf::Color::White);
+            appendRect(bars, histBar.left + histBar.width, top, 1.0f, histBar.height, sf::Color::White);
+        }
+        appendRect(bars, histBar.left, top, histBar.width, histBar.height, fill);
+    }
+}
+
+void updateHistogram(std::vector<HistogramBar> &histogram, sf::VertexArray &bars, HistogramModel &model, Hud &hud)
+{
+    const bool changed = model.rescale || !model.dirtyBins.empty();
+    for (int bin : model.dirtyBins)
+    {
+        if (histogram[bin].valueText >= 0)
+            setHudCount(hud, histogram[bin].valueText, "", model.binVisits[bin]);
+        model.dirty[bin] = 0;
+        if (!model.rescale)
+            layoutHistogramBar(histogram[bin], histogramBarHeight(model, model.binValue(bin)), hud);
+    }
+    model.dirtyBins.clear();
+
+    if (model.rescale)
+    {
+        for (size_t bin = 0; bin < histogram.size(); ++bin)
+            layoutHistogramBar(histogram[bin], histogramBarHeight(model, model.binValue(static_cast<int>(bin))), hud);
+        model.rescale = false;
+    }
+    if (changed)
+        appendHistogramBars(bars, histogram);
+}
+
+void layoutExactOverlay(sf::VertexArray &overlay, const HistogramModel &model, const std::vector<double> &binShare)
+{
+    overlay.setPrimitiveType(sf::Triangles);
+    overlay.clear();
+    double total = 0.0;
+    for (std::uint64_t count : model.binVisits)
+        total += static_cast<double>(count);
+    if (total <= 0.0 || binShare.size() != model.binVisits.size())
+        return;
+
+    const float barWidth = HIST_WIDTH / model.binCount();
+    for (int bin = 0; bin < model.binCount(); ++bin)
+    {
+        double expected = total * binShare[bin] / (model.binFirstState[bin + 1] - model.binFirstState[bin]);
+        float height = std::min(histogramBarHeight(model, expected), HIST_HEIGHT);
+        appendRect(overlay, HIST_X + bin * barWidth, HIST_Y + HIST_HEIGHT - height - 1.0f, barWidth, 2.0f, sf::Color(255, 140, 0));
+    }
+}
+
+sf::Color generateRandomColor(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> colorDist(100, 255);
+    return sf::Color(colorDist(rng), colorDist(rng), colorDist(rng));
+}
+
+int splitBall(BallStore &balls, size_t i, int totalBalls, float multiplicativeFactor, std::mt19937 &rng)
+{
+    if (totalBalls == 0)
+        return 0;
+
+    // Create the new balls
+    sf::Vector2f parentPos = balls.position[i];
+    for (int c = 0; c < totalBalls; ++c)
+    {
+        size_t child = (c == 0) ? i : balls.spawnCopy(i);
+        if (multiplicativeFactor > 1)
+        {
+            balls.color[child] = generateRandomColor(rng);
+        }
+        else
+        {
+            balls.color[child] = sf::Color::Green;
+        }
+        balls.clearTrail(child);
+        balls.hasReachedEnd[child] = 0;
+
+        // Add slight position offset for visual separation
+        float offsetX = (c - totalBalls / 2.0f) * 5.0f;
+        balls.position[child].x = parentPos.x + offsetX;
+    }
+
+    return totalBalls;
+}
@@ -0,0 +1,195 @@
+#include "ssr_engine.hpp"
+
+int splitCount(float multiplicativeFactor, std::mt19937 &rng)
+{
+    int wholePart = static_cast<int>(multiplicativeFactor);
+    float fractionalPart = multiplicativeFactor - wholePart;
+
+    int totalBalls = wholePart;
+    if (fractionalPart > 0)
+    {
+        std::uniform_real_distribution<float> probDist(0.0f, 1.0f);
+        if (probDist(rng) < fractionalPart)
+            totalBalls += 1;
+    }
+    return totalBalls;
+}
+
+std::uint64_t runParticleCycle(std::vector<std::uint64_t> &visits, const SsrProcess &process, float multiplicativeFactor,
+                               std::mt19937 &rng, std::vector<int> &pending)
+{
+    const int boxCount = process.boxCount;
+    std::uint64_t steps = 0;
+    pending.clear();
+    pending.push_back(0);
+
+    while (!pending.empty())
+    {
+        int box = pending.back();
+        pending.pop_back();
+
+        if (box > 0)
+        {
+            visits[box]++;
+            steps++;
+        }
+        if (box == boxCount - 1)
+            continue;
+
+        int totalBalls = splitCount(multiplicativeFactor, rng);
+        for (int i = 0; i < totalBalls; ++i)
+            pending.push_back(sampleTarget(process, box, rng));
+    }
+    return steps;
+}
+
+std::uint64_t runCascade(std::vector<std::uint64_t> &population, std::vector<std::uint64_t> &visits,
+                         const SsrProcess &process, float multiplicativeFactor, std::mt19937 &rng)
+{
+    const int boxCount = static_cast<int>(population.size());
+    const std::uint64_t wholePart = static_cast<std::uint64_t>(multiplicativeFactor);
+    const double fractionalPart = multiplicativeFactor - static_cast<float>(wholePart);
+
+    std::uint64_t steps = 0;
+    std::uint64_t inFlight = 0;
+    std::uint64_t restarted = 0; // noise jumps, in flight from box 0 on the next sweep
+    do
+    {
+        inFlight = restarted;
+        restarted = 0;
+        for (int box = 0; box < boxCount; ++box)
+        {
+            std::uint64_t arrivals = population[box];
+            population[box] = 0;
+            if (inFlight > 0 && box > 0)
+            {
+                std::uint64_t landed = inFlight;
+                if (box < boxCount - 1)
+                {
+                    std::binomial_distribution<std::uint64_t> landDist(inFlight, landingHazard(process, box));
+                    landed = landDist(rng);
+                }
+                inFlight -= landed;
+                arrivals += landed;
+            }
+            if (arrivals == 0)
+                continue;
+
+            if (box > 0)
+            {
+                visits[box] += arrivals;
+                steps += arrivals;
+            }
+            if (box == boxCount - 1)
+                continue;
+
+            // Offspring of the whole population at once
+            std::uint64_t offspring = arrivals * wholePart;
+            if (fractionalPart > 0)
+            {
+                std::binomial_distribution<std::uint64_t> extraDist(arrivals, fractionalPart);
+                offspring += extraDist(rng);
+            }
+            if (process.noise > 0.0 && offspring > 0)
+            {
+                std::binomial_distribution<std::uint64_t> noiseDist(offspring, process.noise);
+                std::uint64_t noisy = noiseDist(rng);
+                offspring -= noisy;
+                restarted += noisy;
+            }
+            inFlight += offspring;
+        }
+    } while (restarted > 0);
+    return steps;
+}
+
+std::mt19937 makeWorkerRng(std::uint32_t seed, unsigned worker)
+{
+    std::seed_seq seq{seed, static_cast<std::uint32_t>(worker)};
+    return std::mt19937(seq);
+}
+
+unsigned resolveThreadCount(unsigned requested)
+{
+    if (requested > 0)
+        return requested;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+std::uint64_t runCycles(const EngineConfig &config, const SsrProcess &process, std::uint64_t cycles,
+                        std::mt19937 &rng, std::vector<std::uint64_t> &visits)
+{
+    std::vector<int> pending;
+    pending.reserve(64);
+    std::vector<std::uint64_t> population(config.boxCount, 0);
+    std::uint64_t steps = 0;
+    for (std::uint64_t c = 0; c < cycles; ++c)
+    {
+        if (config.mode == EngineMode::Cascade)
+        {
+            population[0] = 1;
+            steps += runCascade(population, visits, process, config.multiplicativeFactor, rng);
+        }
+        else
+        {
+            steps += runParticleCycle(visits, process, config.multiplicativeFactor, rng, pending);
+        }
+    }
+    return steps;
+}
+
+bool runEngine(const EngineConfig &config, EngineResult &result)
+{
+    SsrProcess process;
+    if (!makeProcess(process, config.boxCount, config.prior, config.noise))
+        return false;
+
+    unsigned threadCount = resolveThreadCount(config.threads);
+    threadCount = static_cast<unsigned>(std::min<std::uint64_t>(threadCount, std::max<std::uint64_t>(config.cycles, 1)));
+
+    std::vector<std::vector<std::uint64_t>> threadVisits(threadCount, std::vector<std::uint64_t>(config.boxCount, 0));
+    std::vector<std::uint64_t> threadSteps(threadCount, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        std::uint64_t cycles = config.cycles / threadCount + (t < config.cycles % threadCount ? 1 : 0);
+        workers.emplace_back([&, t, cycles]()
+                             {
+            std::mt19937 rng = makeWorkerRng(config.seed, t);
+            threadSteps[t] = runCycles(config, process, cycles, rng, threadVisits[t]); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    // Merge per-thread histograms
+    result = EngineResult();
+    result.visits.assign(config.boxCount, 0);
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        for (int i = 0; i < config.boxCount; ++i)
+            result.visits[i] += threadVisits[t][i];
+        result.steps += threadSteps[t];
+    }
+    result.cycles = config.cycles;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+double maxVisitZScore(const EngineResult &a, const EngineResult &b)
+{
+    double maxZ = 0.0;
+    for (size_t box = 1; box < a.visits.size(); ++box)
+    {
+        double meanA = static_cast<double>(a.visits[box]) / a.cycles;
+        double meanB = static_cast<double>(b.visits[box]) / b.cycles;
+        double pooled = (static_cast<double>(a.visits[box]) + b.visits[box]) / (a.cycles + b.cycles);
+        double variance = pooled * (1.0 - std::min(pooled, 1.0)) * (1.0 / a.cycles + 1.0 / b.cycles);
+        if (variance > 0.0)
+            maxZ = std::max(maxZ, std::abs(meanA - meanB) / std::sqrt(variance));
+    }
+    return maxZ;
+}
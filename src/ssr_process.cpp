@@ -0,0 +1,148 @@
+#include "ssr_process.hpp"
+#include "exact_distribution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+const int GUIDE_SCAN_LIMIT = 8; // linear steps before a draw switches to binary search
+
+SsrProcess makeUniformProcess(int boxCount)
+{
+    SsrProcess process;
+    makeProcess(process, boxCount, std::vector<double>(), 0.0);
+    return process;
+}
+
+bool makeProcess(SsrProcess &process, int boxCount, const std::vector<double> &stateWeights, double noise)
+{
+    const int states = boxCount - 1;
+    process.boxCount = boxCount;
+    process.noise = std::min(std::max(noise, 0.0), 1.0);
+    process.uniform = stateWeights.empty();
+    process.cumulative.assign(boxCount, 0.0);
+    process.guide.clear();
+
+    for (int state = 1; state <= states; ++state)
+    {
+        double weight = 1.0;
+        if (!process.uniform)
+            weight = state <= static_cast<int>(stateWeights.size()) ? stateWeights[state - 1] : 0.0;
+        if (weight < 0.0 || !std::isfinite(weight))
+            return false;
+        process.cumulative[state] = process.cumulative[state - 1] + weight;
+    }
+    // A ball must always have somewhere to land, and state 1 is below every box
+    if (states >= 1 && process.cumulative[1] <= 0.0)
+        return false;
+    const double total = process.cumulative[states];
+
+    // Equal weights are the classic process, sampled without the tables
+    if (!process.uniform)
+    {
+        auto first = stateWeights.begin();
+        auto last = stateWeights.begin() + std::min(static_cast<int>(stateWeights.size()), states);
+        process.uniform = static_cast<int>(stateWeights.size()) >= states &&
+                          std::all_of(first, last, [&](double w) { return w == *first; });
+    }
+    if (process.uniform)
+        return true;
+
+    process.guide.resize(boxCount);
+    int state = 1;
+    for (int g = 0; g < boxCount; ++g)
+    {
+        double threshold = total * g / boxCount;
+        while (state < states && process.cumulative[state] <= threshold)
+            state++;
+        process.guide[g] = state;
+    }
+    return true;
+}
+
+std::vector<double> powerPrior(int states, double exponent)
+{
+    std::vector<double> weights(states);
+    for (int s = 1; s <= states; ++s)
+        weights[s - 1] = std::pow(static_cast<double>(s), exponent);
+    return weights;
+}
+
+bool loadPriorWeights(const std::string &path, std::vector<double> &weights)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    weights.clear();
+    double weight;
+    while (file >> weight)
+        weights.push_back(weight);
+    return !weights.empty();
+}
+
+double boxWeight(const SsrProcess &process, int box)
+{
+    int state = process.boxCount - box;
+    return box > 0 ? process.cumulative[state] - process.cumulative[state - 1] : 0.0;
+}
+
+double landingHazard(const SsrProcess &process, int box)
+{
+    if (box >= process.boxCount - 1)
+        return 1.0;
+    return boxWeight(process, box) / process.cumulative[process.boxCount - box];
+}
+
+int samplePriorTarget(const SsrProcess &process, int box, std::mt19937 &rng)
+{
+    const std::vector<double> &cumulative = process.cumulative;
+    const int below = process.boxCount - box - 1; // highest state the ball can reach
+    const double total = cumulative[process.boxCount - 1];
+    double u = cumulative[below] * std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+
+    size_t g = std::min(static_cast<size_t>(u / total * process.guide.size()), process.guide.size() - 1);
+    int state = std::min(process.guide[g], below);
+    for (int scanned = 0; state < below && cumulative[state] <= u; ++scanned, ++state)
+    {
+        if (scanned == GUIDE_SCAN_LIMIT)
+        {
+            auto found = std::upper_bound(cumulative.begin() + state, cumulative.begin() + below, u);
+            state = static_cast<int>(found - cumulative.begin());
+            break;
+        }
+    }
+    return process.boxCount - state;
+}
+
+int sampleTarget(const SsrProcess &process, int box, std::mt19937 &rng)
+{
+    if (process.noise > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < process.noise)
+        box = 0; // noise: any state can follow
+    if (process.uniform)
+        return std::uniform_int_distribution<int>(box + 1, process.boxCount - 1)(rng);
+    return samplePriorTarget(process, box, rng);
+}
+
+double noiseRestartMean(const SsrProcess &process, float multiplicativeFactor)
+{
+    if (process.noise <= 0.0)
+        return 0.0;
+
+    // A noise jump is one ball in flight from box 0; it does not split first
+    std::vector<double> arrivals;
+    return sweepArrivals(process, multiplicativeFactor, 0.0, 1.0, arrivals);
+}
+
+bool cycleTerminates(const SsrProcess &process, float multiplicativeFactor)
+{
+    return noiseRestartMean(process, multiplicativeFactor) < 1.0;
+}
+
+std::string describeProcess(const SsrProcess &process)
+{
+    std::ostringstream out;
+    out << (process.uniform ? "uniform" : "prior");
+    if (process.noise > 0.0)
+        out << " noise " << process.noise;
+    return out.str();
+}
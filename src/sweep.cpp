@@ -0,0 +1,206 @@
+#include "sweep.hpp"
+#include "thread_pool.hpp"
+#include <functional>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+
+std::vector<double> parseList(const char *value)
+{
+    std::vector<double> values;
+    char *end = nullptr;
+    for (const char *p = value; *p; p = *end ? end + 1 : end)
+    {
+        values.push_back(std::strtod(p, &end));
+        if (end == p)
+            return std::vector<double>();
+    }
+    return values;
+}
+
+std::vector<int> makeLogStateBins(int states)
+{
+    std::vector<int> edges{1};
+    const double ratio = std::pow(10.0, 1.0 / SWEEP_BINS_PER_DECADE);
+    while (edges.back() <= states)
+    {
+        int next = static_cast<int>(std::ceil(edges.back() * ratio));
+        edges.push_back(std::min(std::max(next, edges.back() + 1), states + 1));
+    }
+    return edges;
+}
+
+double fitPowerLawExponent(const std::vector<int> &binEdges, const std::vector<std::uint64_t> &binVisits)
+{
+    double sumW = 0.0, sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    int used = 0;
+    for (size_t b = 0; b < binVisits.size(); ++b)
+    {
+        if (binVisits[b] == 0)
+            continue;
+        int width = binEdges[b + 1] - binEdges[b];
+        double w = static_cast<double>(binVisits[b]);
+        double x = 0.5 * (std::log(binEdges[b]) + std::log(binEdges[b + 1] - 1));
+        double y = std::log(w / width);
+        sumW += w;
+        sumX += w * x;
+        sumY += w * y;
+        sumXX += w * x * x;
+        sumXY += w * x * y;
+        used++;
+    }
+    double denominator = sumW * sumXX - sumX * sumX;
+    if (used < 2 || denominator <= 0.0)
+        return 0.0;
+    return -(sumW * sumXY - sumX * sumY) / denominator;
+}
+
+bool makeSweepProcess(SsrProcess &process, const SweepConfig &config, int states)
+{
+    std::vector<double> prior = config.base.prior;
+    if (prior.empty() && config.priorPower != 0.0)
+        prior = powerPrior(states, config.priorPower);
+    return makeProcess(process, states + 1, prior, config.base.noise);
+}
+
+// Everything one grid point needs while its batches run
+struct SweepRun
+{
+    EngineConfig config;
+    SsrProcess process;
+    std::vector<int> binEdges;
+    std::vector<int> stateBin; // stateBin[state] is the bin of the state
+    std::vector<std::vector<std::uint64_t>> batchBins;
+    std::vector<std::uint64_t> batchSteps;
+    std::vector<double> batchSeconds;
+};
+
+// CPU time of the calling thread. A batch runs on one pool thread from start to
+// end, so this leaves out the time it waited for a core.
+double threadCpuSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void runSweepBatch(SweepRun &run, std::uint32_t stream, int batch, std::uint64_t cycles)
+{
+    double start = threadCpuSeconds();
+    std::mt19937 rng = makeWorkerRng(run.config.seed, stream);
+    std::vector<std::uint64_t> visits(run.config.boxCount, 0);
+    run.batchSteps[batch] = runCycles(run.config, run.process, cycles, rng, visits);
+
+    std::vector<std::uint64_t> &bins = run.batchBins[batch];
+    bins.assign(run.binEdges.size() - 1, 0);
+    for (int box = 1; box < run.config.boxCount; ++box)
+        bins[run.stateBin[run.config.boxCount - box]] += visits[box];
+    run.batchSeconds[batch] = threadCpuSeconds() - start;
+}
+
+// Point estimate from all batches, interval from resampling whole batches
+void fitSweepRun(const SweepRun &run, int bootstrap, std::uint32_t stream, SweepRow &row)
+{
+    const size_t batches = run.batchBins.size();
+    std::vector<std::uint64_t> total(run.binEdges.size() - 1, 0);
+    for (size_t b = 0; b < batches; ++b)
+    {
+        for (size_t k = 0; k < total.size(); ++k)
+            total[k] += run.batchBins[b][k];
+        row.steps += run.batchSteps[b];
+        row.cpuSeconds += run.batchSeconds[b];
+    }
+    row.exponent = fitPowerLawExponent(run.binEdges, total);
+    row.exponentLow = row.exponentHigh = row.exponent;
+    if (bootstrap <= 0 || batches < 2)
+        return;
+
+    std::mt19937 rng = makeWorkerRng(run.config.seed, stream);
+    std::uniform_int_distribution<size_t> pick(0, batches - 1);
+    std::vector<double> estimates(bootstrap);
+    for (int r = 0; r < bootstrap; ++r)
+    {
+        std::fill(total.begin(), total.end(), 0);
+        for (size_t b = 0; b < batches; ++b)
+        {
+            const std::vector<std::uint64_t> &bins = run.batchBins[pick(rng)];
+            for (size_t k = 0; k < total.size(); ++k)
+                total[k] += bins[k];
+        }
+        estimates[r] = fitPowerLawExponent(run.binEdges, total);
+    }
+    std::sort(estimates.begin(), estimates.end());
+    row.exponentLow = estimates[static_cast<size_t>(0.025 * (bootstrap - 1))];
+    row.exponentHigh = estimates[static_cast<size_t>(0.975 * (bootstrap - 1))];
+}
+
+std::vector<SweepRow> runSweep(const SweepConfig &config)
+{
+    const int batches = std::max(config.batches, 1);
+    std::vector<SweepRun> runs;
+    std::vector<SweepRow> rows;
+    for (float factor : config.factors)
+    {
+        for (int states : config.stateCounts)
+        {
+            SweepRun run;
+            run.config = config.base;
+            run.config.multiplicativeFactor = factor;
+            run.config.boxCount = states + 1;
+            if (!makeSweepProcess(run.process, config, states))
+                return std::vector<SweepRow>();
+
+            run.binEdges = makeLogStateBins(states);
+            run.stateBin.assign(states + 1, 0);
+            for (size_t b = 0; b + 1 < run.binEdges.size(); ++b)
+                std::fill(run.stateBin.begin() + run.binEdges[b], run.stateBin.begin() + run.binEdges[b + 1], static_cast<int>(b));
+            run.batchBins.resize(batches);
+            run.batchSteps.assign(batches, 0);
+            run.batchSeconds.assign(batches, 0.0);
+            runs.push_back(std::move(run));
+
+            SweepRow row;
+            row.multiplicativeFactor = factor;
+            row.states = states;
+            row.cycles = config.base.cycles;
+            rows.push_back(row);
+        }
+    }
+
+    // Every batch has its own stream, so results do not depend on the thread count
+    std::vector<std::function<void()>> tasks;
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        for (int b = 0; b < batches; ++b)
+        {
+            std::uint64_t cycles = config.base.cycles / batches + (static_cast<std::uint64_t>(b) < config.base.cycles % batches ? 1 : 0);
+            std::uint32_t stream = static_cast<std::uint32_t>(r * batches + b);
+            tasks.push_back([&runs, r, b, stream, cycles]()
+                            { runSweepBatch(runs[r], stream, b, cycles); });
+        }
+    }
+    runTasks(tasks, config.base.threads);
+
+    const std::uint32_t fitStreams = static_cast<std::uint32_t>(runs.size() * batches);
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        tasks.push_back([&runs, &rows, &config, r, fitStreams]()
+                        { fitSweepRun(runs[r], config.bootstrap, fitStreams + static_cast<std::uint32_t>(r), rows[r]); });
+    }
+    runTasks(tasks, config.base.threads);
+    return rows;
+}
+
+void writeSweepTable(const SweepConfig &config, const std::vector<SweepRow> &rows, std::ostream &out)
+{
+    out << "# sweep cycles " << config.base.cycles << " batches " << config.batches << " bootstrap " << config.bootstrap
+        << " seed " << config.base.seed << " noise " << config.base.noise << " prior_power " << config.priorPower << "\n";
+    out << "# factor states cycles steps_per_cycle exponent exponent_low exponent_high cpu_seconds\n";
+    for (const SweepRow &row : rows)
+    {
+        double stepsPerCycle = row.cycles > 0 ? static_cast<double>(row.steps) / row.cycles : 0.0;
+        out << std::setprecision(6) << row.multiplicativeFactor << " " << row.states << " " << row.cycles << " " << std::setprecision(8)
+            << stepsPerCycle << " " << std::setprecision(5) << row.exponent << " " << row.exponentLow << " "
+            << row.exponentHigh << " " << std::setprecision(4) << row.cpuSeconds << "\n";
+    }
+}
@@ -0,0 +1,54 @@
+#include "thread_pool.hpp"
+#include "ssr_engine.hpp"
+
+// Pops from the back of the worker's own queue, or steals from the front of another
+bool takeTask(std::vector<TaskQueue> &queues, unsigned worker, std::function<void()> &task)
+{
+    {
+        TaskQueue &own = queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k)
+    {
+        TaskQueue &victim = queues[(worker + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void runTasks(std::vector<std::function<void()>> &tasks, unsigned threads)
+{
+    unsigned threadCount = resolveThreadCount(threads);
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(tasks.size(), 1)));
+
+    std::vector<TaskQueue> queues(threadCount);
+    for (size_t i = 0; i < tasks.size(); ++i)
+        queues[i % threadCount].tasks.push_back(std::move(tasks[i]));
+    tasks.clear();
+
+    // Tasks never queue more tasks, so a worker that finds every queue empty is done
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        workers.emplace_back([&queues, t]()
+                             {
+            std::function<void()> task;
+            while (takeTask(queues, t, task))
+                task(); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+}